@@ -0,0 +1,185 @@
+#include "alpha_sampler.h"
+
+namespace InSomnia
+{
+    Alpha_Sampler::Alpha_Sampler()
+    {
+        this->width = 0;
+        this->height = 0;
+    }
+    
+    Alpha_Sampler::Alpha_Sampler(const cv::Mat &img_bgra)
+    {
+        if (img_bgra.channels() != 4)
+        {
+            throw std::runtime_error(
+                "Ошибка: изображение должно быть в формате BGRA!\n");
+        }
+        
+        this->width = img_bgra.cols;
+        this->height = img_bgra.rows;
+        
+        for (int y = 0; y < this->height; ++y)
+        {
+            const cv::Vec4b *row = img_bgra.ptr<cv::Vec4b>(y);
+            
+            for (int x = 0; x < this->width; ++x)
+            {
+                if (row[x][3] > 0)
+                {
+                    this->vec_opaque.push_back(y * this->width + x);
+                }
+            }
+        }
+        
+        if (this->vec_opaque.empty())
+        {
+            throw std::runtime_error(
+                "Ошибка: в изображении нет непрозрачных пикселей\n");
+        }
+    }
+    
+    uint32_t Alpha_Sampler::get_count_opaque() const
+    {
+        return this->vec_opaque.size();
+    }
+    
+    cv::Point2f Alpha_Sampler::sample_uniform(std::mt19937 &gen) const
+    {
+        std::uniform_int_distribution<uint32_t> idx_dist(
+            0u, this->vec_opaque.size() - 1);
+        
+        const uint32_t idx = this->vec_opaque[idx_dist(gen)];
+        
+        return cv::Point2f(idx % this->width, idx / this->width);
+    }
+    
+    std::vector<cv::Point2f> Alpha_Sampler::sample_uniform(
+        const uint32_t count,
+        std::mt19937 &gen) const
+    {
+        std::vector<cv::Point2f> points(count);
+        
+        for (cv::Point2f &point : points)
+        {
+            point = this->sample_uniform(gen);
+        }
+        
+        return points;
+    }
+    
+    std::vector<cv::Point2f> Alpha_Sampler::sample_poisson_disk(
+        const uint32_t count,
+        std::mt19937 &gen) const
+    {
+        // Попыток на одну точку, прежде чем уменьшить расстояние
+        static constexpr uint32_t count_attempts = 30u;
+        // Доля от расстояния плотной упаковки, которая
+        // обычно достигается бросанием дротиков
+        static constexpr float fraction_packing = 0.7f;
+        static constexpr float factor_shrink = 0.85f;
+        
+        std::vector<cv::Point2f> points;
+        points.reserve(count);
+        
+        if (count == 0u)
+        {
+            return points;
+        }
+        
+        // В одном пикселе не бывает двух точек
+        if (count > this->vec_opaque.size())
+        {
+            throw std::runtime_error(
+                "Ошибка: точек больше, чем непрозрачных пикселей\n");
+        }
+        
+        // Гексагональная упаковка: на точку приходится
+        // sqrt(3) / 2 * d^2 пикселей
+        float min_distance = fraction_packing * std::sqrt(
+            this->vec_opaque.size() / (count * std::sqrt(3.f) / 2.f));
+        
+        std::vector<int32_t> grid;
+        
+        while (points.size() < count)
+        {
+            // Не больше одной точки в ячейке: её диагональ
+            // равна min_distance
+            const float size_cell =
+                std::max(min_distance / std::sqrt(2.f), 1.f);
+            const int cols_grid =
+                static_cast<int>(std::ceil(this->width / size_cell));
+            const int rows_grid =
+                static_cast<int>(std::ceil(this->height / size_cell));
+            
+            grid.assign(cols_grid * rows_grid, -1);
+            
+            const auto get_cell = [size_cell](const float value)
+            {
+                return static_cast<int>(value / size_cell);
+            };
+            
+            // Уже принятые точки при меньшем расстоянии остаются
+            for (uint32_t i = 0u; i < points.size(); ++i)
+            {
+                grid[get_cell(points[i].y) * cols_grid +
+                    get_cell(points[i].x)] = i;
+            }
+            
+            const float min_distance_2 = min_distance * min_distance;
+            const uint64_t limit_attempts =
+                static_cast<uint64_t>(count_attempts) * count;
+            
+            for (uint64_t attempt = 0u;
+                 attempt < limit_attempts && points.size() < count;
+                 ++attempt)
+            {
+                const cv::Point2f candidate = this->sample_uniform(gen);
+                const int cx = get_cell(candidate.x);
+                const int cy = get_cell(candidate.y);
+                
+                if (grid[cy * cols_grid + cx] >= 0)
+                {
+                    continue;
+                }
+                
+                bool is_free = true;
+                
+                for (int y = std::max(0, cy - 2);
+                     y <= std::min(rows_grid - 1, cy + 2) && is_free;
+                     ++y)
+                {
+                    for (int x = std::max(0, cx - 2);
+                         x <= std::min(cols_grid - 1, cx + 2);
+                         ++x)
+                    {
+                        const int32_t idx = grid[y * cols_grid + x];
+                        if (idx < 0)
+                        {
+                            continue;
+                        }
+                        
+                        const float dx = points[idx].x - candidate.x;
+                        const float dy = points[idx].y - candidate.y;
+                        if (dx * dx + dy * dy < min_distance_2)
+                        {
+                            is_free = false;
+                            break;
+                        }
+                    }
+                }
+                
+                if (is_free)
+                {
+                    grid[cy * cols_grid + cx] = points.size();
+                    points.push_back(candidate);
+                }
+            }
+            
+            min_distance *= factor_shrink;
+        }
+        
+        return points;
+    }
+    
+}
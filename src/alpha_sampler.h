@@ -0,0 +1,49 @@
+#ifndef INSOMNIA_ALPHA_SAMPLER_H
+#define INSOMNIA_ALPHA_SAMPLER_H
+
+#include <random>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace InSomnia
+{
+    // Случайные точки в непрозрачной части BGRA-изображения.
+    // Непрозрачные пиксели (alpha > 0) собираются в список один раз,
+    // так что выбор точки — один индекс, сколько бы ни было
+    // прозрачных пикселей вокруг
+    class Alpha_Sampler
+    {
+    public:
+        Alpha_Sampler();
+        
+        // Пустая маска — исключение, а не бесконечный поиск
+        explicit Alpha_Sampler(const cv::Mat &img_bgra);
+        
+        uint32_t get_count_opaque() const;
+        
+        // Равномерно по непрозрачным пикселям
+        cv::Point2f sample_uniform(std::mt19937 &gen) const;
+        
+        std::vector<cv::Point2f> sample_uniform(
+            const uint32_t count,
+            std::mt19937 &gen) const;
+        
+        // Синий шум: точки не ближе min_distance друг к другу,
+        // проверка соседей — по сетке с ячейкой min_distance / sqrt(2).
+        // Расстояние выбирается по площади маски; если точки
+        // не помещаются, оно уменьшается, пока не войдут все count
+        std::vector<cv::Point2f> sample_poisson_disk(
+            const uint32_t count,
+            std::mt19937 &gen) const;
+        
+    private:
+        int width;
+        int height;
+        
+        // y * width + x непрозрачных пикселей
+        std::vector<uint32_t> vec_opaque;
+    };
+}
+
+#endif
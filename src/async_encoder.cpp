@@ -0,0 +1,76 @@
+#include "async_encoder.h"
+
+namespace InSomnia
+{
+    Async_Encoder::Async_Encoder(
+        const Frame_Write_Function &write,
+        const uint32_t capacity)
+        : queue(capacity)
+    {
+        this->write = write;
+        this->thread = std::thread(&Async_Encoder::encode_loop, this);
+    }
+    
+    Async_Encoder::~Async_Encoder()
+    {
+        this->queue.close();
+        if (this->thread.joinable())
+        {
+            this->thread.join();
+        }
+    }
+    
+    void Async_Encoder::push(
+        const uint32_t frame_idx,
+        const cv::Mat &frame)
+    {
+        // Очередь закрывается только кодировщиком при ошибке
+        if (!(this->queue.push(frame_idx, frame)))
+        {
+            this->close();
+        }
+    }
+    
+    void Async_Encoder::close()
+    {
+        this->queue.close();
+        if (this->thread.joinable())
+        {
+            this->thread.join();
+        }
+        
+        if (this->error)
+        {
+            std::exception_ptr error = this->error;
+            this->error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+    
+    Frame_Queue_Stats Async_Encoder::get_stats() const
+    {
+        return this->queue.get_stats();
+    }
+    
+    void Async_Encoder::encode_loop()
+    {
+        uint32_t frame_idx = 0u;
+        cv::Mat frame;
+        
+        try
+        {
+            while (this->queue.pop(frame_idx, frame))
+            {
+                this->write(frame_idx, frame);
+                frame.release();
+            }
+        }
+        catch (...)
+        {
+            // error читается только после join
+            this->error = std::current_exception();
+            this->queue.close();
+        }
+    }
+    
+}
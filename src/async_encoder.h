@@ -0,0 +1,53 @@
+#ifndef INSOMNIA_ASYNC_ENCODER_H
+#define INSOMNIA_ASYNC_ENCODER_H
+
+#include <exception>
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame_queue.h"
+#include "render_pipeline.h"
+
+namespace InSomnia
+{
+    // Кодирование в отдельном потоке: рендер кадра N + 1
+    // идёт одновременно с записью кадра N. Между стадиями —
+    // ограниченная очередь, её статистика показывает,
+    // какая стадия узкое место
+    class Async_Encoder
+    {
+    public:
+        // write вызывается в потоке кодировщика строго по порядку push
+        Async_Encoder(
+            const Frame_Write_Function &write,
+            const uint32_t capacity);
+        
+        // Дописывает оставшиеся кадры
+        ~Async_Encoder();
+        
+        Async_Encoder(const Async_Encoder &) = delete;
+        Async_Encoder& operator=(const Async_Encoder &) = delete;
+        
+        // Ждёт места в очереди. Ошибка кодировщика
+        // пробрасывается отсюда или из close
+        void push(
+            const uint32_t frame_idx,
+            const cv::Mat &frame);
+        
+        // Дожидается записи всех кадров
+        void close();
+        
+        Frame_Queue_Stats get_stats() const;
+        
+    private:
+        Frame_Write_Function write;
+        Frame_Queue queue;
+        std::thread thread;
+        std::exception_ptr error;
+        
+        void encode_loop();
+    };
+}
+
+#endif
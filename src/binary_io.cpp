@@ -0,0 +1,73 @@
+#include "binary_io.h"
+
+namespace InSomnia
+{
+    Binary_Writer::Binary_Writer()
+    {
+        
+    }
+    
+    void Binary_Writer::write_string(const std::string &value)
+    {
+        this->write<uint64_t>(value.size());
+        this->data.insert(this->data.end(), value.begin(), value.end());
+    }
+    
+    void Binary_Writer::write_bytes(const std::vector<uint8_t> &bytes)
+    {
+        this->write_vector(bytes);
+    }
+    
+    const std::vector<uint8_t>& Binary_Writer::get_data() const
+    {
+        return this->data;
+    }
+    
+    Binary_Reader::Binary_Reader(
+        const uint8_t *data,
+        const size_t size)
+    {
+        this->data = data;
+        this->size = size;
+        this->position = 0u;
+    }
+    
+    std::string Binary_Reader::read_string()
+    {
+        const uint64_t count = this->read<uint64_t>();
+        if (count > this->get_remaining())
+        {
+            throw std::runtime_error(
+                "Ошибка: двоичные данные обрезаны\n");
+        }
+        
+        const char *chars = reinterpret_cast<const char*>(this->take(count));
+        
+        return std::string(chars, chars + count);
+    }
+    
+    std::vector<uint8_t> Binary_Reader::read_bytes()
+    {
+        return this->read_vector<uint8_t>();
+    }
+    
+    size_t Binary_Reader::get_remaining() const
+    {
+        return this->size - this->position;
+    }
+    
+    const uint8_t* Binary_Reader::take(const size_t count)
+    {
+        if (count > this->get_remaining())
+        {
+            throw std::runtime_error(
+                "Ошибка: двоичные данные обрезаны\n");
+        }
+        
+        const uint8_t *ptr = this->data + this->position;
+        this->position += count;
+        
+        return ptr;
+    }
+    
+}
@@ -0,0 +1,107 @@
+#ifndef INSOMNIA_BINARY_IO_H
+#define INSOMNIA_BINARY_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace InSomnia
+{
+    // Компактная двоичная запись состояния: числа как есть
+    // (little-endian на всех целевых машинах), векторы и строки
+    // с длиной впереди
+    class Binary_Writer
+    {
+    public:
+        Binary_Writer();
+        
+        template <typename T>
+        void write(const T &value)
+        {
+            static_assert(std::is_arithmetic_v<T>);
+            
+            const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+            this->data.insert(this->data.end(), bytes, bytes + sizeof(T));
+        }
+        
+        template <typename T>
+        void write_vector(const std::vector<T> &values)
+        {
+            static_assert(std::is_arithmetic_v<T>);
+            
+            this->write<uint64_t>(values.size());
+            
+            const uint8_t *bytes =
+                reinterpret_cast<const uint8_t*>(values.data());
+            this->data.insert(
+                this->data.end(), bytes, bytes + sizeof(T) * values.size());
+        }
+        
+        void write_string(const std::string &value);
+        
+        void write_bytes(const std::vector<uint8_t> &bytes);
+        
+        const std::vector<uint8_t>& get_data() const;
+        
+    private:
+        std::vector<uint8_t> data;
+    };
+    
+    // Чтение того, что записал Binary_Writer. Выход за конец
+    // данных — исключение, а не мусор в состоянии
+    class Binary_Reader
+    {
+    public:
+        Binary_Reader(
+            const uint8_t *data,
+            const size_t size);
+        
+        template <typename T>
+        T read()
+        {
+            static_assert(std::is_arithmetic_v<T>);
+            
+            T value;
+            std::memcpy(&value, this->take(sizeof(T)), sizeof(T));
+            
+            return value;
+        }
+        
+        template <typename T>
+        std::vector<T> read_vector()
+        {
+            static_assert(std::is_arithmetic_v<T>);
+            
+            const uint64_t count = this->read<uint64_t>();
+            if (count > this->get_remaining() / sizeof(T))
+            {
+                throw std::runtime_error(
+                    "Ошибка: двоичные данные обрезаны\n");
+            }
+            
+            std::vector<T> values(count);
+            std::memcpy(
+                values.data(), this->take(sizeof(T) * count), sizeof(T) * count);
+            
+            return values;
+        }
+        
+        std::string read_string();
+        
+        std::vector<uint8_t> read_bytes();
+        
+        size_t get_remaining() const;
+        
+    private:
+        const uint8_t *data;
+        size_t size;
+        size_t position;
+        
+        const uint8_t* take(const size_t count);
+    };
+}
+
+#endif
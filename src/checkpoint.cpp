@@ -0,0 +1,165 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "binary_io.h"
+
+namespace InSomnia
+{
+    static constexpr char magic[8] = { 'I', 'N', 'S', 'M', 'C', 'K', 'P', 'T' };
+    static constexpr uint32_t version = 2u;
+    
+    // FNV-1a: обнаруживает обрезанный или испорченный файл
+    static uint64_t checksum(
+        const uint8_t *data,
+        const size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0u; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= 0x100000001b3ull;
+        }
+        
+        return hash;
+    }
+    
+    void save_checkpoint(
+        const std::string &path_file,
+        const Checkpoint &checkpoint)
+    {
+        Binary_Writer writer;
+        
+        writer.write<int32_t>(checkpoint.width);
+        writer.write<int32_t>(checkpoint.height);
+        writer.write<int32_t>(checkpoint.fps);
+        writer.write<uint32_t>(checkpoint.total_frames);
+        writer.write<uint64_t>(checkpoint.seed);
+        writer.write<uint8_t>(static_cast<uint8_t>(checkpoint.format));
+        writer.write<uint32_t>(checkpoint.frame_begin);
+        writer.write<uint32_t>(checkpoint.frame_end);
+        writer.write<uint32_t>(checkpoint.frame_next);
+        writer.write_vector(checkpoint.frames_sink_start);
+        writer.write_bytes(checkpoint.state_scene);
+        
+        const std::vector<uint8_t> &payload = writer.get_data();
+        const uint64_t sum = checksum(payload.data(), payload.size());
+        
+        const std::string path_tmp = path_file + ".tmp";
+        std::FILE *file = std::fopen(path_tmp.c_str(), "wb");
+        
+        if (file == nullptr)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось открыть файл " + path_tmp + "\n");
+        }
+        
+        bool is_ok =
+            std::fwrite(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+            std::fwrite(&version, sizeof(version), 1, file) == 1u &&
+            std::fwrite(payload.data(), 1, payload.size(), file) ==
+                payload.size() &&
+            std::fwrite(&sum, sizeof(sum), 1, file) == 1u;
+        is_ok = (std::fclose(file) == 0) && is_ok;
+        
+        if (!is_ok)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось записать контрольную точку " +
+                path_tmp + "\n");
+        }
+        
+        std::filesystem::rename(path_tmp, path_file);
+    }
+    
+    bool load_checkpoint(
+        const std::string &path_file,
+        Checkpoint &checkpoint)
+    {
+        if (!std::filesystem::exists(path_file))
+        {
+            return false;
+        }
+        
+        const size_t size = std::filesystem::file_size(path_file);
+        std::vector<uint8_t> data(size);
+        
+        std::FILE *file = std::fopen(path_file.c_str(), "rb");
+        if (file == nullptr)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось открыть файл " + path_file + "\n");
+        }
+        
+        const bool is_read = std::fread(data.data(), 1, size, file) == size;
+        std::fclose(file);
+        
+        const size_t size_head = sizeof(magic) + sizeof(version);
+        const size_t size_sum = sizeof(uint64_t);
+        
+        if (!is_read ||
+            size < size_head + size_sum ||
+            std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+        {
+            throw std::runtime_error(
+                "Ошибка: " + path_file + " — не контрольная точка\n");
+        }
+        
+        uint32_t version_file = 0u;
+        std::memcpy(&version_file, data.data() + sizeof(magic), sizeof(version));
+        if (version_file != version)
+        {
+            throw std::runtime_error(
+                "Ошибка: другая версия контрольной точки " + path_file + "\n");
+        }
+        
+        const uint8_t *payload = data.data() + size_head;
+        const size_t size_payload = size - size_head - size_sum;
+        
+        uint64_t sum = 0u;
+        std::memcpy(&sum, payload + size_payload, size_sum);
+        if (sum != checksum(payload, size_payload))
+        {
+            throw std::runtime_error(
+                "Ошибка: контрольная точка " + path_file + " повреждена\n");
+        }
+        
+        Binary_Reader reader(payload, size_payload);
+        
+        checkpoint.width = reader.read<int32_t>();
+        checkpoint.height = reader.read<int32_t>();
+        checkpoint.fps = reader.read<int32_t>();
+        checkpoint.total_frames = reader.read<uint32_t>();
+        checkpoint.seed = reader.read<uint64_t>();
+        checkpoint.format = static_cast<Frame_Format>(reader.read<uint8_t>());
+        checkpoint.frame_begin = reader.read<uint32_t>();
+        checkpoint.frame_end = reader.read<uint32_t>();
+        checkpoint.frame_next = reader.read<uint32_t>();
+        checkpoint.frames_sink_start = reader.read_vector<uint32_t>();
+        checkpoint.state_scene = reader.read_bytes();
+        
+        return true;
+    }
+    
+    bool is_checkpoint_for(
+        const Checkpoint &checkpoint,
+        const Scene_Config &config,
+        const uint32_t frame_begin,
+        const uint32_t frame_end)
+    {
+        return
+            checkpoint.width == config.width &&
+            checkpoint.height == config.height &&
+            checkpoint.fps == config.fps &&
+            checkpoint.total_frames == config.total_frames &&
+            checkpoint.seed == config.seed &&
+            checkpoint.format == config.format &&
+            checkpoint.frame_begin == frame_begin &&
+            checkpoint.frame_end == frame_end &&
+            checkpoint.frame_next >= frame_begin &&
+            checkpoint.frame_next <= frame_end;
+    }
+    
+}
@@ -0,0 +1,56 @@
+#ifndef INSOMNIA_CHECKPOINT_H
+#define INSOMNIA_CHECKPOINT_H
+
+#include <string>
+#include <vector>
+
+#include "scene.h"
+
+namespace InSomnia
+{
+    // Контрольная точка сегмента [frame_begin, frame_end):
+    // кадры до frame_next записаны, выходы закрыты, state_scene —
+    // состояние сцены перед кадром frame_next
+    struct Checkpoint
+    {
+        // Настройки, с которыми точка снята
+        int width;
+        int height;
+        int fps;
+        uint32_t total_frames;
+        uint64_t seed;
+        Frame_Format format;
+        uint32_t frame_begin;
+        uint32_t frame_end;
+        
+        uint32_t frame_next;
+        
+        // Первые кадры закрытых выходов сегмента по порядку
+        std::vector<uint32_t> frames_sink_start;
+        
+        // Пусто, когда сегмент закончен
+        std::vector<uint8_t> state_scene;
+    };
+    
+    // Файл: сигнатура, версия, данные и контрольная сумма.
+    // Пишется во временный файл и переименовывается, так что
+    // при падении на диске остаётся прежняя целая точка
+    void save_checkpoint(
+        const std::string &path_file,
+        const Checkpoint &checkpoint);
+    
+    // false — файла нет. Повреждённый файл или другая
+    // версия формата — исключение
+    bool load_checkpoint(
+        const std::string &path_file,
+        Checkpoint &checkpoint);
+    
+    // Точка снята для той же сцены и того же сегмента
+    bool is_checkpoint_for(
+        const Checkpoint &checkpoint,
+        const Scene_Config &config,
+        const uint32_t frame_begin,
+        const uint32_t frame_end);
+}
+
+#endif
@@ -0,0 +1,395 @@
+#include "compositor.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef INSOMNIA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace InSomnia
+{
+    // Точное округлённое деление на 255 для x из [0, 255 * 255]
+    static inline uint32_t div_255(const uint32_t x)
+    {
+        const uint32_t t = x + 128u;
+        return (t + (t >> 8)) >> 8;
+    }
+    
+    void blend_row_scalar(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const uint8_t *s = src_bgra + 4 * i;
+            uint8_t *d = dst_bgr + 3 * i;
+            
+            const uint32_t a = s[3];
+            if (a == 0u)
+            {
+                continue;
+            }
+            if (a == 255u)
+            {
+                d[0] = s[0];
+                d[1] = s[1];
+                d[2] = s[2];
+                continue;
+            }
+            
+            const uint32_t na = 255u - a;
+            d[0] = static_cast<uint8_t>(div_255(s[0] * a + d[0] * na));
+            d[1] = static_cast<uint8_t>(div_255(s[1] * a + d[1] * na));
+            d[2] = static_cast<uint8_t>(div_255(s[2] * a + d[2] * na));
+        }
+    }
+
+    void blend_row_premultiplied_scalar(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const uint8_t *s = src_bgra + 4 * i;
+            uint8_t *d = dst_bgr + 3 * i;
+            
+            const uint32_t na = 255u - s[3];
+            d[0] = static_cast<uint8_t>(s[0] + div_255(d[0] * na));
+            d[1] = static_cast<uint8_t>(s[1] + div_255(d[1] * na));
+            d[2] = static_cast<uint8_t>(s[2] + div_255(d[2] * na));
+        }
+    }
+    
+    void blend_plane_premultiplied(
+        const uint8_t *src_value,
+        const uint8_t *src_alpha,
+        uint8_t *dst,
+        const int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const uint32_t na = 255u - src_alpha[i];
+            dst[i] = static_cast<uint8_t>(src_value[i] + div_255(dst[i] * na));
+        }
+    }
+    
+    void blend_plane_color(
+        const uint8_t *src_alpha,
+        const uint8_t value,
+        uint8_t *dst,
+        const int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const uint32_t a = src_alpha[i];
+            dst[i] = static_cast<uint8_t>(
+                div_255(value * a + dst[i] * (255u - a)));
+        }
+    }
+    
+    void add_plane_saturate(
+        const uint8_t *src,
+        uint8_t *dst,
+        const int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const uint32_t sum = static_cast<uint32_t>(dst[i]) + src[i];
+            dst[i] = static_cast<uint8_t>(std::min(sum, 255u));
+        }
+    }
+    
+    void add_plane_signed(
+        const int8_t *src_delta,
+        uint8_t *dst,
+        const int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const int32_t sum = static_cast<int32_t>(dst[i]) + src_delta[i];
+            dst[i] = static_cast<uint8_t>(std::clamp(sum, 0, 255));
+        }
+    }
+
+#ifdef INSOMNIA_X86_SIMD
+    
+    // Записывает первые 12 байт регистра (4 пикселя BGR)
+    __attribute__((target("sse4.1")))
+    static inline void store_12_bytes(uint8_t *dst, const __m128i v)
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), v);
+        const int32_t tail = _mm_extract_epi32(v, 2);
+        std::memcpy(dst + 8, &tail, sizeof(tail));
+    }
+    
+    // s, d, a — 16-битные значения; возвращает div_255(s*a + d*(255-a)),
+    // а для умноженной альфы s + div_255(d*(255-a)).
+    // Сумма не превышает 255 * 255 + 128 и помещается в uint16
+    template <bool premultiplied>
+    __attribute__((target("sse4.1")))
+    static inline __m128i blend_epi16_sse(
+        const __m128i s,
+        const __m128i d,
+        const __m128i a)
+    {
+        const __m128i v255 = _mm_set1_epi16(255);
+        const __m128i v128 = _mm_set1_epi16(128);
+        
+        __m128i t = _mm_mullo_epi16(d, _mm_sub_epi16(v255, a));
+        if constexpr (!premultiplied)
+        {
+            t = _mm_add_epi16(t, _mm_mullo_epi16(s, a));
+        }
+        t = _mm_add_epi16(t, v128);
+        t = _mm_srli_epi16(
+            _mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        if constexpr (premultiplied)
+        {
+            t = _mm_add_epi16(t, s);
+        }
+        return t;
+    }
+    
+    template <bool premultiplied>
+    __attribute__((target("sse4.1")))
+    static void blend_row_sse41_impl(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count)
+    {
+        const __m128i shuffle_alpha = _mm_setr_epi8(
+            3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+        const __m128i shuffle_expand = _mm_setr_epi8(
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i shuffle_pack = _mm_setr_epi8(
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m128i mask_alpha = _mm_set1_epi32(
+            static_cast<int32_t>(0xFF000000u));
+        
+        int i = 0;
+        
+        // Читаем 16 байт кадра на 4 пикселя (12 байт),
+        // поэтому впереди должно оставаться не меньше 6 пикселей
+        for (; i + 6 <= count; i += 4)
+        {
+            const __m128i s = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(src_bgra + 4 * i));
+            
+            // Все 4 пикселя прозрачные — кадр не трогаем
+            if (_mm_testz_si128(s, mask_alpha))
+            {
+                continue;
+            }
+            
+            uint8_t *dst = dst_bgr + 3 * i;
+            const __m128i d = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst)),
+                shuffle_expand);
+            const __m128i a = _mm_shuffle_epi8(s, shuffle_alpha);
+            
+            const __m128i lo = blend_epi16_sse<premultiplied>(
+                _mm_cvtepu8_epi16(s),
+                _mm_cvtepu8_epi16(d),
+                _mm_cvtepu8_epi16(a));
+            const __m128i hi = blend_epi16_sse<premultiplied>(
+                _mm_cvtepu8_epi16(_mm_srli_si128(s, 8)),
+                _mm_cvtepu8_epi16(_mm_srli_si128(d, 8)),
+                _mm_cvtepu8_epi16(_mm_srli_si128(a, 8)));
+            
+            store_12_bytes(
+                dst,
+                _mm_shuffle_epi8(_mm_packus_epi16(lo, hi), shuffle_pack));
+        }
+        
+        if constexpr (premultiplied)
+        {
+            blend_row_premultiplied_scalar(
+                src_bgra + 4 * i, dst_bgr + 3 * i, count - i);
+        }
+        else
+        {
+            blend_row_scalar(
+                src_bgra + 4 * i, dst_bgr + 3 * i, count - i);
+        }
+    }
+    
+    template <bool premultiplied>
+    __attribute__((target("avx2")))
+    static inline __m256i blend_epi16_avx(
+        const __m256i s,
+        const __m256i d,
+        const __m256i a)
+    {
+        const __m256i v255 = _mm256_set1_epi16(255);
+        const __m256i v128 = _mm256_set1_epi16(128);
+        
+        __m256i t = _mm256_mullo_epi16(d, _mm256_sub_epi16(v255, a));
+        if constexpr (!premultiplied)
+        {
+            t = _mm256_add_epi16(t, _mm256_mullo_epi16(s, a));
+        }
+        t = _mm256_add_epi16(t, v128);
+        t = _mm256_srli_epi16(
+            _mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+        if constexpr (premultiplied)
+        {
+            t = _mm256_add_epi16(t, s);
+        }
+        return t;
+    }
+    
+    template <bool premultiplied>
+    __attribute__((target("avx2")))
+    static void blend_row_avx2_impl(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count)
+    {
+        // Маски действуют в пределах каждой 128-битной половины
+        const __m256i shuffle_alpha = _mm256_setr_epi8(
+            3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15,
+            3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+        const __m256i shuffle_expand = _mm256_setr_epi8(
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m256i shuffle_pack = _mm256_setr_epi8(
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m256i mask_alpha = _mm256_set1_epi32(
+            static_cast<int32_t>(0xFF000000u));
+        const __m256i zero = _mm256_setzero_si256();
+        
+        int i = 0;
+        
+        // Вторая половина кадра читается с отступом 12 байт:
+        // 12 + 16 = 28 байт, то есть впереди не меньше 10 пикселей
+        for (; i + 10 <= count; i += 8)
+        {
+            const __m256i s = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(src_bgra + 4 * i));
+            
+            if (_mm256_testz_si256(s, mask_alpha))
+            {
+                continue;
+            }
+            
+            uint8_t *dst = dst_bgr + 3 * i;
+            const __m256i d = _mm256_shuffle_epi8(
+                _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(
+                        _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(dst))),
+                    _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(dst + 12)),
+                    1),
+                shuffle_expand);
+            const __m256i a = _mm256_shuffle_epi8(s, shuffle_alpha);
+            
+            const __m256i lo = blend_epi16_avx<premultiplied>(
+                _mm256_unpacklo_epi8(s, zero),
+                _mm256_unpacklo_epi8(d, zero),
+                _mm256_unpacklo_epi8(a, zero));
+            const __m256i hi = blend_epi16_avx<premultiplied>(
+                _mm256_unpackhi_epi8(s, zero),
+                _mm256_unpackhi_epi8(d, zero),
+                _mm256_unpackhi_epi8(a, zero));
+            
+            const __m256i packed = _mm256_shuffle_epi8(
+                _mm256_packus_epi16(lo, hi), shuffle_pack);
+            
+            store_12_bytes(dst, _mm256_castsi256_si128(packed));
+            store_12_bytes(dst + 12, _mm256_extracti128_si256(packed, 1));
+        }
+        
+        blend_row_sse41_impl<premultiplied>(
+            src_bgra + 4 * i, dst_bgr + 3 * i, count - i);
+    }
+    
+    void blend_row_sse41(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count)
+    {
+        blend_row_sse41_impl<false>(src_bgra, dst_bgr, count);
+    }
+    
+    void blend_row_avx2(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count)
+    {
+        blend_row_avx2_impl<false>(src_bgra, dst_bgr, count);
+    }
+    
+    void blend_row_premultiplied_sse41(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count)
+    {
+        blend_row_sse41_impl<true>(src_bgra, dst_bgr, count);
+    }
+    
+    void blend_row_premultiplied_avx2(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count)
+    {
+        blend_row_avx2_impl<true>(src_bgra, dst_bgr, count);
+    }
+
+#endif
+    
+    static Blend_Row_Function select_blend_row()
+    {
+#ifdef INSOMNIA_X86_SIMD
+        __builtin_cpu_init();
+        
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return blend_row_avx2;
+        }
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            return blend_row_sse41;
+        }
+#endif
+        return blend_row_scalar;
+    }
+    
+    static Blend_Row_Function select_blend_row_premultiplied()
+    {
+#ifdef INSOMNIA_X86_SIMD
+        __builtin_cpu_init();
+        
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return blend_row_premultiplied_avx2;
+        }
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            return blend_row_premultiplied_sse41;
+        }
+#endif
+        return blend_row_premultiplied_scalar;
+    }
+    
+    Blend_Row_Function get_blend_row()
+    {
+        static const Blend_Row_Function blend_row =
+            select_blend_row();
+        
+        return blend_row;
+    }
+    
+    Blend_Row_Function get_blend_row_premultiplied()
+    {
+        static const Blend_Row_Function blend_row =
+            select_blend_row_premultiplied();
+        
+        return blend_row;
+    }
+    
+}
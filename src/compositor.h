@@ -0,0 +1,91 @@
+#ifndef INSOMNIA_COMPOSITOR_H
+#define INSOMNIA_COMPOSITOR_H
+
+#include <cstdint>
+
+// Ядра SSE4.1/AVX2 собираются только для x86 под GCC/Clang,
+// выбор между ними делается во время выполнения
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define INSOMNIA_X86_SIMD 1
+#endif
+
+namespace InSomnia
+{
+    // Смешивает строку из count пикселей BGRA (неумноженная альфа)
+    // со строкой кадра BGR, целочисленно: (s * a + d * (255 - a)) / 255
+    using Blend_Row_Function = void (*)(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count);
+    
+    void blend_row_scalar(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count);
+    
+    // То же для умноженной на альфу BGRA: s + d * (255 - a) / 255
+    void blend_row_premultiplied_scalar(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count);
+    
+    // Одна плоскость с умноженной альфой (Y, U или V кадра 4:2:0):
+    // dst = value + dst * (255 - alpha) / 255. Плоскости не
+    // перемежаются, и цикл без ветвлений векторизует компилятор
+    void blend_plane_premultiplied(
+        const uint8_t *src_value,
+        const uint8_t *src_alpha,
+        uint8_t *dst,
+        const int count);
+    
+    // Одна плоскость, залитая одним значением с альфой:
+    // dst = (value * alpha + dst * (255 - alpha)) / 255
+    void blend_plane_color(
+        const uint8_t *src_alpha,
+        const uint8_t value,
+        uint8_t *dst,
+        const int count);
+    
+    // Сложение света: dst = min(dst + src, 255). Подходит и для
+    // строки BGR (count = 3 * ширина), и для плоскости яркости
+    void add_plane_saturate(
+        const uint8_t *src,
+        uint8_t *dst,
+        const int count);
+    
+    // Сдвиг цветности со знаком: dst = clamp(dst + delta, 0, 255)
+    void add_plane_signed(
+        const int8_t *src_delta,
+        uint8_t *dst,
+        const int count);
+
+#ifdef INSOMNIA_X86_SIMD
+    void blend_row_sse41(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count);
+    
+    void blend_row_avx2(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count);
+    
+    void blend_row_premultiplied_sse41(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count);
+    
+    void blend_row_premultiplied_avx2(
+        const uint8_t *src_bgra,
+        uint8_t *dst_bgr,
+        const int count);
+#endif
+    
+    // Лучшее ядро для текущего процессора (определяется один раз)
+    Blend_Row_Function get_blend_row();
+    
+    Blend_Row_Function get_blend_row_premultiplied();
+}
+
+#endif
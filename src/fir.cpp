@@ -51,7 +51,7 @@ namespace InSomnia
         const float y,
         cv::Mat &frame)
     {
-        draw_figure_to_frame(this->img, x, y, frame);
+        draw_sprite_to_frame(this->sprite, x, y, frame);
     }
     
     const cv::Mat& Fir::get_img() const
@@ -92,7 +92,9 @@ namespace InSomnia
             cv::Size(target_width, target_height),
             0,
             0,
-            cv::INTER_AREA);  
+            cv::INTER_AREA);
+        
+        this->sprite = Sprite(this->img);
     }
     
 }
@@ -4,6 +4,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "toolbox.h"
+#include "sprite.h"
 
 namespace InSomnia
 {
@@ -34,6 +35,7 @@ namespace InSomnia
         
     private:
         cv::Mat img;
+        Sprite sprite;
         
         void load(
             const std::string &path_file,
@@ -0,0 +1,133 @@
+#include "frame_pool.h"
+
+#include <cstring>
+
+#ifdef INSOMNIA_HUGE_PAGES
+#include <sys/mman.h>
+#endif
+
+namespace InSomnia
+{
+    // Большая страница x86-64; на ней же выравниваются буферы
+    static constexpr size_t size_huge_page = 2u << 20;
+    
+    Frame_Pool::Frame_Pool(
+        const int width,
+        const int height,
+        const int type,
+        const uint32_t count_buffers,
+        const bool use_huge_pages)
+    {
+        if (width <= 0 || height <= 0 || count_buffers == 0u)
+        {
+            throw std::runtime_error(
+                "Ошибка: неверные параметры Frame_Pool\n");
+        }
+        
+        this->width = width;
+        this->height = height;
+        this->type = type;
+        
+        const size_t size_frame =
+            static_cast<size_t>(width) * height * CV_ELEM_SIZE(type);
+        this->size_buffer =
+            (size_frame + size_huge_page - 1) / size_huge_page * size_huge_page;
+        this->size_memory = this->size_buffer * count_buffers;
+        
+        this->memory = nullptr;
+        this->is_mapped = false;
+
+#ifdef INSOMNIA_HUGE_PAGES
+        if (use_huge_pages)
+        {
+            void *p = mmap(
+                nullptr,
+                this->size_memory,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS,
+                -1,
+                0);
+            
+            if (p != MAP_FAILED)
+            {
+                // Совет, а не требование: без THP останутся
+                // обычные страницы
+                madvise(p, this->size_memory, MADV_HUGEPAGE);
+                
+                this->memory = static_cast<uint8_t*>(p);
+                this->is_mapped = true;
+            }
+        }
+#else
+        (void)use_huge_pages;
+#endif
+        
+        if (this->memory == nullptr)
+        {
+            this->memory = static_cast<uint8_t*>(
+                cv::fastMalloc(this->size_memory));
+        }
+        
+        // Страницы получаем сейчас, а не на первых кадрах
+        std::memset(this->memory, 0, this->size_memory);
+        
+        this->free_buffers.reserve(count_buffers);
+        for (uint32_t i = count_buffers; i > 0u; --i)
+        {
+            this->free_buffers.push_back(
+                this->memory + (i - 1) * this->size_buffer);
+        }
+    }
+    
+    Frame_Pool::~Frame_Pool()
+    {
+#ifdef INSOMNIA_HUGE_PAGES
+        if (this->is_mapped)
+        {
+            munmap(this->memory, this->size_memory);
+            return;
+        }
+#endif
+        cv::fastFree(this->memory);
+    }
+    
+    cv::Mat Frame_Pool::acquire()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        
+        this->cv_free.wait(lock, [this]()
+        {
+            return !(this->free_buffers.empty());
+        });
+        
+        uint8_t *buffer = this->free_buffers.back();
+        this->free_buffers.pop_back();
+        
+        return cv::Mat(this->height, this->width, this->type, buffer);
+    }
+    
+    void Frame_Pool::release(const cv::Mat &frame)
+    {
+        uint8_t *buffer = frame.data;
+        
+        if (buffer < this->memory ||
+            buffer >= this->memory + this->size_memory ||
+            (buffer - this->memory) % this->size_buffer != 0)
+        {
+            throw std::runtime_error(
+                "Ошибка: кадр не из этого Frame_Pool\n");
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->free_buffers.push_back(buffer);
+        }
+        this->cv_free.notify_one();
+    }
+    
+    uint32_t Frame_Pool::get_count_buffers() const
+    {
+        return this->size_memory / this->size_buffer;
+    }
+    
+}
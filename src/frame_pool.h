@@ -0,0 +1,62 @@
+#ifndef INSOMNIA_FRAME_POOL_H
+#define INSOMNIA_FRAME_POOL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Большие страницы через mmap + madvise есть только в Linux
+#if defined(__linux__)
+#define INSOMNIA_HUGE_PAGES 1
+#endif
+
+namespace InSomnia
+{
+    // Заранее выделенные буферы кадров. Рендер берёт буфер,
+    // кодировщик возвращает его после записи, так что на кадр
+    // нет ни выделения памяти, ни обнуления, ни первых обращений
+    // к страницам. Память — одно отображение, по желанию
+    // на больших страницах (Linux, MADV_HUGEPAGE)
+    class Frame_Pool
+    {
+    public:
+        Frame_Pool(
+            const int width,
+            const int height,
+            const int type,
+            const uint32_t count_buffers,
+            const bool use_huge_pages);
+        
+        ~Frame_Pool();
+        
+        Frame_Pool(const Frame_Pool &) = delete;
+        Frame_Pool& operator=(const Frame_Pool &) = delete;
+        
+        // Ждёт свободного буфера. Кадр ссылается на память пула
+        // и должен вернуться через release
+        cv::Mat acquire();
+        
+        void release(const cv::Mat &frame);
+        
+        uint32_t get_count_buffers() const;
+        
+    private:
+        int width;
+        int height;
+        int type;
+        
+        size_t size_buffer; // С выравниванием до большой страницы
+        size_t size_memory;
+        uint8_t *memory;
+        bool is_mapped;
+        
+        std::vector<uint8_t*> free_buffers;
+        
+        std::mutex mutex;
+        std::condition_variable cv_free;
+    };
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "frame_queue.h"
+
+#include <chrono>
+
+namespace InSomnia
+{
+    Frame_Queue::Frame_Queue(const uint32_t capacity)
+    {
+        if (capacity == 0u)
+        {
+            throw std::runtime_error(
+                "Ошибка: ёмкость Frame_Queue должна быть больше нуля\n");
+        }
+        
+        this->slots = std::vector<Slot>(capacity);
+        this->count_pushed = 0u;
+        this->count_popped = 0u;
+        this->is_closed = false;
+        
+        this->stats = Frame_Queue_Stats();
+        this->stats.capacity = capacity;
+        this->sum_occupancy = 0.;
+    }
+    
+    bool Frame_Queue::push(
+        const uint32_t frame_idx,
+        const cv::Mat &frame)
+    {
+        using Clock = std::chrono::steady_clock;
+        
+        const uint64_t capacity = this->slots.size();
+        
+        std::unique_lock<std::mutex> lock(this->mutex);
+        
+        if (!(this->is_closed) &&
+            this->count_pushed - this->count_popped == capacity)
+        {
+            const Clock::time_point time_begin = Clock::now();
+            
+            this->cv_not_full.wait(lock, [this, capacity]()
+            {
+                return
+                    this->is_closed ||
+                    this->count_pushed - this->count_popped < capacity;
+            });
+            
+            ++(this->stats.count_push_waits);
+            this->stats.seconds_push_wait +=
+                std::chrono::duration<double>(Clock::now() - time_begin).count();
+        }
+        
+        if (this->is_closed)
+        {
+            return false;
+        }
+        
+        Slot &slot = this->slots[this->count_pushed % capacity];
+        slot.frame_idx = frame_idx;
+        slot.frame = frame;
+        ++(this->count_pushed);
+        
+        const uint32_t occupancy = this->count_pushed - this->count_popped;
+        ++(this->stats.count_push);
+        this->sum_occupancy += occupancy;
+        this->stats.max_occupancy =
+            std::max(this->stats.max_occupancy, occupancy);
+        
+        lock.unlock();
+        this->cv_not_empty.notify_one();
+        
+        return true;
+    }
+    
+    bool Frame_Queue::pop(
+        uint32_t &frame_idx,
+        cv::Mat &frame)
+    {
+        using Clock = std::chrono::steady_clock;
+        
+        const uint64_t capacity = this->slots.size();
+        
+        std::unique_lock<std::mutex> lock(this->mutex);
+        
+        if (!(this->is_closed) &&
+            this->count_pushed == this->count_popped)
+        {
+            const Clock::time_point time_begin = Clock::now();
+            
+            this->cv_not_empty.wait(lock, [this]()
+            {
+                return
+                    this->is_closed ||
+                    this->count_pushed > this->count_popped;
+            });
+            
+            ++(this->stats.count_pop_waits);
+            this->stats.seconds_pop_wait +=
+                std::chrono::duration<double>(Clock::now() - time_begin).count();
+        }
+        
+        if (this->count_pushed == this->count_popped)
+        {
+            return false;
+        }
+        
+        // Забираем заголовок, слот больше не держит пиксели
+        Slot &slot = this->slots[this->count_popped % capacity];
+        frame_idx = slot.frame_idx;
+        frame = std::move(slot.frame);
+        slot.frame = cv::Mat();
+        ++(this->count_popped);
+        
+        lock.unlock();
+        this->cv_not_full.notify_one();
+        
+        return true;
+    }
+    
+    void Frame_Queue::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->is_closed = true;
+        }
+        this->cv_not_full.notify_all();
+        this->cv_not_empty.notify_all();
+    }
+    
+    Frame_Queue_Stats Frame_Queue::get_stats() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        
+        Frame_Queue_Stats result = this->stats;
+        result.mean_occupancy =
+            result.count_push > 0u ?
+            this->sum_occupancy / result.count_push : 0.;
+        result.occupancy = this->count_pushed - this->count_popped;
+        
+        return result;
+    }
+    
+}
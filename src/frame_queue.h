@@ -0,0 +1,73 @@
+#ifndef INSOMNIA_FRAME_QUEUE_H
+#define INSOMNIA_FRAME_QUEUE_H
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace InSomnia
+{
+    // Заполненность очереди глазами обеих сторон.
+    // Много ожиданий у производителя — узкое место в потребителе
+    // (кодировщике), много ожиданий у потребителя — в рендере
+    struct Frame_Queue_Stats
+    {
+        uint32_t capacity;
+        uint64_t count_push;
+        uint64_t count_push_waits; // Очередь была полна
+        double seconds_push_wait;
+        uint64_t count_pop_waits;  // Очередь была пуста
+        double seconds_pop_wait;
+        double mean_occupancy;     // Средняя заполненность при push
+        uint32_t max_occupancy;
+        uint32_t occupancy;        // Заполненность сейчас
+    };
+    
+    // Ограниченное кольцо кадров для одного производителя
+    // и одного потребителя. Кадры передаются без копирования
+    // пикселей: в кольце лежат заголовки cv::Mat
+    class Frame_Queue
+    {
+    public:
+        explicit Frame_Queue(const uint32_t capacity);
+        
+        // Ждёт свободного места. false — очередь закрыта
+        bool push(
+            const uint32_t frame_idx,
+            const cv::Mat &frame);
+        
+        // Ждёт кадра. false — очередь закрыта и пуста
+        bool pop(
+            uint32_t &frame_idx,
+            cv::Mat &frame);
+        
+        // Новые кадры больше не принимаются, потребитель
+        // дочитывает оставшиеся
+        void close();
+        
+        Frame_Queue_Stats get_stats() const;
+        
+    private:
+        struct Slot
+        {
+            uint32_t frame_idx;
+            cv::Mat frame;
+        };
+        
+        std::vector<Slot> slots;
+        uint64_t count_pushed; // Голова кольца
+        uint64_t count_popped; // Хвост кольца
+        bool is_closed;
+        
+        mutable std::mutex mutex;
+        std::condition_variable cv_not_full;
+        std::condition_variable cv_not_empty;
+        
+        Frame_Queue_Stats stats;
+        double sum_occupancy;
+    };
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include "frame_sink.h"
+
+#include <chrono>
+#include <filesystem>
+
+namespace InSomnia
+{
+    using Clock = std::chrono::steady_clock;
+    
+    static double seconds_since(const Clock::time_point time_begin)
+    {
+        return std::chrono::duration<double>(Clock::now() - time_begin).count();
+    }
+    
+    Frame_Sink::~Frame_Sink()
+    {
+        
+    }
+    
+    Null_Sink::Null_Sink()
+    {
+        this->stats = Sink_Stats();
+    }
+    
+    void Null_Sink::push(
+        const uint32_t /*frame_idx*/,
+        const cv::Mat &/*frame*/)
+    {
+        ++(this->stats.count_frames);
+    }
+    
+    void Null_Sink::flush()
+    {
+        
+    }
+    
+    void Null_Sink::close()
+    {
+        
+    }
+    
+    Sink_Stats Null_Sink::get_stats() const
+    {
+        return this->stats;
+    }
+    
+    Video_Writer_Sink::Video_Writer_Sink(
+        const std::string &path_file,
+        const int width,
+        const int height,
+        const int fps)
+    {
+        this->path_file = path_file;
+        this->size = cv::Size(width, height);
+        this->stats = Sink_Stats();
+        
+        this->video_writer.open(
+            path_file,
+            cv::VideoWriter::fourcc('m', 'p', '4', 'v'),
+            fps,
+            this->size);
+        
+        if (!(this->video_writer.isOpened()))
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось открыть VideoWriter\n");
+        }
+    }
+    
+    Video_Writer_Sink::~Video_Writer_Sink()
+    {
+        this->video_writer.release();
+    }
+    
+    void Video_Writer_Sink::push(
+        const uint32_t /*frame_idx*/,
+        const cv::Mat &frame)
+    {
+        if (!(this->video_writer.isOpened()))
+        {
+            throw std::runtime_error(
+                "Ошибка: Video_Writer_Sink уже закрыт\n");
+        }
+        
+        if (frame.size() != this->size || frame.type() != CV_8UC3)
+        {
+            throw std::runtime_error(
+                "Ошибка: кадр не совпадает с размером видео\n");
+        }
+        
+        const Clock::time_point time_begin = Clock::now();
+        
+        // VideoWriter кодирует кадр сразу и пикселей не хранит
+        this->video_writer.write(frame);
+        
+        ++(this->stats.count_frames);
+        this->stats.seconds += seconds_since(time_begin);
+    }
+    
+    void Video_Writer_Sink::flush()
+    {
+        // У cv::VideoWriter нет отдельного сброса,
+        // файл дописывается при release
+    }
+    
+    void Video_Writer_Sink::close()
+    {
+        if (!(this->video_writer.isOpened()))
+        {
+            return;
+        }
+        
+        const Clock::time_point time_begin = Clock::now();
+        
+        this->video_writer.release();
+        
+        this->stats.seconds += seconds_since(time_begin);
+        
+        std::error_code error;
+        const uintmax_t size_file =
+            std::filesystem::file_size(this->path_file, error);
+        this->stats.bytes_written = error ? 0u : size_file;
+    }
+    
+    Sink_Stats Video_Writer_Sink::get_stats() const
+    {
+        return this->stats;
+    }
+    
+}
@@ -0,0 +1,93 @@
+#ifndef INSOMNIA_FRAME_SINK_H
+#define INSOMNIA_FRAME_SINK_H
+
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+namespace InSomnia
+{
+    struct Sink_Stats
+    {
+        uint64_t count_frames;
+        uint64_t bytes_written;
+        double seconds; // Время вызывающего внутри push, flush и close
+    };
+    
+    // Приёмник кадров: видео собирается по одному кадру,
+    // всё видео целиком в памяти не держится.
+    // push блокируется, пока приёмник не готов принять кадр, —
+    // это и есть обратное давление на рендер. После возврата
+    // из push приёмник не ссылается на пиксели кадра,
+    // буфер можно сразу использовать снова
+    class Frame_Sink
+    {
+    public:
+        virtual ~Frame_Sink();
+        
+        // Кадры приходят по возрастанию frame_idx
+        virtual void push(
+            const uint32_t frame_idx,
+            const cv::Mat &frame) = 0;
+        
+        // Дописывает всё, что накоплено внутри приёмника
+        virtual void flush() = 0;
+        
+        // flush и освобождение ресурсов; push после close — ошибка
+        virtual void close() = 0;
+        
+        virtual Sink_Stats get_stats() const = 0;
+    };
+    
+    // Ничего не пишет: для замеров чистого рендера
+    class Null_Sink : public Frame_Sink
+    {
+    public:
+        Null_Sink();
+        
+        void push(
+            const uint32_t frame_idx,
+            const cv::Mat &frame) override;
+        
+        void flush() override;
+        
+        void close() override;
+        
+        Sink_Stats get_stats() const override;
+        
+    private:
+        Sink_Stats stats;
+    };
+    
+    // Видео через cv::VideoWriter (mp4v), как прежний write_video_to_file
+    class Video_Writer_Sink : public Frame_Sink
+    {
+    public:
+        Video_Writer_Sink(
+            const std::string &path_file,
+            const int width,
+            const int height,
+            const int fps);
+        
+        ~Video_Writer_Sink() override;
+        
+        void push(
+            const uint32_t frame_idx,
+            const cv::Mat &frame) override;
+        
+        void flush() override;
+        
+        void close() override;
+        
+        // Размер файла известен после close
+        Sink_Stats get_stats() const override;
+        
+    private:
+        std::string path_file;
+        cv::VideoWriter video_writer;
+        cv::Size size;
+        Sink_Stats stats;
+    };
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "frame_yuv420.h"
+
+namespace InSomnia
+{
+    Frame_Yuv420::Frame_Yuv420(cv::Mat &buffer)
+    {
+        const int width = buffer.cols;
+        const int height = buffer.rows * 2 / 3;
+        
+        if (buffer.type() != CV_8UC1 ||
+            !buffer.isContinuous() ||
+            width % 2 != 0 ||
+            height % 2 != 0 ||
+            height * 3 / 2 != buffer.rows)
+        {
+            throw std::runtime_error(
+                "Ошибка: буфер не подходит для кадра YUV 4:2:0\n");
+        }
+        
+        const size_t size_y = static_cast<size_t>(width) * height;
+        const size_t size_chroma = size_y / 4u;
+        
+        this->plane_y = cv::Mat(height, width, CV_8UC1, buffer.data);
+        this->plane_u = cv::Mat(
+            height / 2, width / 2, CV_8UC1, buffer.data + size_y);
+        this->plane_v = cv::Mat(
+            height / 2, width / 2, CV_8UC1, buffer.data + size_y + size_chroma);
+    }
+    
+    int Frame_Yuv420::get_width() const
+    {
+        return this->plane_y.cols;
+    }
+    
+    int Frame_Yuv420::get_height() const
+    {
+        return this->plane_y.rows;
+    }
+    
+    cv::Mat& Frame_Yuv420::get_y()
+    {
+        return this->plane_y;
+    }
+    
+    cv::Mat& Frame_Yuv420::get_u()
+    {
+        return this->plane_u;
+    }
+    
+    cv::Mat& Frame_Yuv420::get_v()
+    {
+        return this->plane_v;
+    }
+    
+    const cv::Mat& Frame_Yuv420::get_y() const
+    {
+        return this->plane_y;
+    }
+    
+    const cv::Mat& Frame_Yuv420::get_u() const
+    {
+        return this->plane_u;
+    }
+    
+    const cv::Mat& Frame_Yuv420::get_v() const
+    {
+        return this->plane_v;
+    }
+    
+    cv::Size get_yuv420_buffer_size(
+        const int width,
+        const int height)
+    {
+        return cv::Size(width, height * 3 / 2);
+    }
+    
+    bool is_yuv420_buffer(
+        const cv::Mat &buffer,
+        const int width,
+        const int height)
+    {
+        return
+            buffer.type() == CV_8UC1 &&
+            buffer.size() == get_yuv420_buffer_size(width, height);
+    }
+    
+    cv::Vec3f bgr_to_yuv(
+        const float b,
+        const float g,
+        const float r)
+    {
+        return bgr_to_yuv_premultiplied(b, g, r, 255.f);
+    }
+    
+    cv::Vec3f bgr_to_yuv_premultiplied(
+        const float b,
+        const float g,
+        const float r,
+        const float a)
+    {
+        const float k = a / 255.f;
+        
+        return cv::Vec3f(
+             16.f * k + 0.257f * r + 0.504f * g + 0.098f * b,
+            128.f * k - 0.148f * r - 0.291f * g + 0.439f * b,
+            128.f * k + 0.439f * r - 0.368f * g - 0.071f * b);
+    }
+    
+}
@@ -0,0 +1,68 @@
+#ifndef INSOMNIA_FRAME_YUV420_H
+#define INSOMNIA_FRAME_YUV420_H
+
+#include <opencv2/opencv.hpp>
+
+namespace InSomnia
+{
+    // Формат кадров рендера
+    enum class Frame_Format
+    {
+        bgr,    // CV_8UC3
+        yuv420  // планарный I420 в одном буфере CV_8UC1
+    };
+    
+    // Кадр YUV 4:2:0 поверх буфера (height * 3 / 2) x width, CV_8UC1,
+    // как у cv::cvtColor(..., COLOR_BGR2YUV_I420): плоскость Y,
+    // за ней U и V в половинном разрешении. Этот буфер кодировщик
+    // принимает без преобразования цвета
+    class Frame_Yuv420
+    {
+    public:
+        // Плоскости ссылаются на память buffer, не копируют её
+        explicit Frame_Yuv420(cv::Mat &buffer);
+        
+        int get_width() const;
+        int get_height() const;
+        
+        cv::Mat& get_y();
+        cv::Mat& get_u();
+        cv::Mat& get_v();
+        
+        const cv::Mat& get_y() const;
+        const cv::Mat& get_u() const;
+        const cv::Mat& get_v() const;
+        
+    private:
+        cv::Mat plane_y;
+        cv::Mat plane_u;
+        cv::Mat plane_v;
+    };
+    
+    // Размер буфера I420 для кадра width x height (стороны чётные)
+    cv::Size get_yuv420_buffer_size(
+        const int width,
+        const int height);
+    
+    bool is_yuv420_buffer(
+        const cv::Mat &buffer,
+        const int width,
+        const int height);
+    
+    // BT.601 с ограниченным диапазоном, как в cv::cvtColor:
+    // компоненты Y, U, V для цвета BGR
+    cv::Vec3f bgr_to_yuv(
+        const float b,
+        const float g,
+        const float r);
+    
+    // То же для цвета, умноженного на альфу a (0..255):
+    // смещения 16 и 128 тоже умножаются на a / 255
+    cv::Vec3f bgr_to_yuv_premultiplied(
+        const float b,
+        const float g,
+        const float r,
+        const float a);
+}
+
+#endif
@@ -2,7 +2,6 @@
 
 namespace InSomnia
 {
-
     Hare::Hare()
     {
         static constexpr double nan =
@@ -13,18 +12,15 @@ namespace InSomnia
         this->vx_per_jump = nan; // Скорость вперёд за прыжок (пикс/сек)
         this->vy_initial = nan; // Начальная скорость вверх (пикс/сек)
         this->ground_y = nan; // Уровень "земли"
-        
-        // Начальные параметры
-        this->current_x = nan; // Начальная позиция X
-        this->current_y = nan; // Начальная позиция Y (на земле)
-        this->is_in_air = false; // Находится ли заяц в воздухе?
+        this->start_x = nan; // Начальная позиция X
         
         // Параметры прыжков
         this->jump_duration = nan; // Длительность одного прыжка
         this->jump_interval = nan; // Задержка между прыжками (сек)
-        this->jump_start_x = nan; // Позиция начала текущего прыжка
-        this->last_landing_time = nan; // Время последнего приземления
-        this->waiting_for_next_jump = false; // Ожидаем начала следующего прыжка
+        
+        this->fps = 0;
+        this->total_frames_trajectory = 0u;
+        this->period_frames = 1u;
     }
     
     Hare::Hare(
@@ -44,18 +40,15 @@ namespace InSomnia
         this->vx_per_jump = vx_per_jump; // Скорость вперёд за прыжок (пикс/сек)
         this->vy_initial = vy_initial; // Начальная скорость вверх (пикс/сек)
         this->ground_y = ground_y; // Уровень "земли"
-        
-        // Начальные параметры
-        this->current_x = start_x; // Начальная позиция X
-        this->current_y = ground_y; // Начальная позиция Y (на земле)
-        this->is_in_air = false; // Находится ли заяц в воздухе?
+        this->start_x = start_x; // Начальная позиция X
         
         // Параметры прыжков
         this->jump_duration = 2.0 * (-vy_initial) / g_pixels_per_sec_sq; // Длительность одного прыжка
         this->jump_interval = jump_interval; // Задержка между прыжками (сек)
-        this->jump_start_x = current_x; // Позиция начала текущего прыжка
-        this->last_landing_time = 0.0; // Время последнего приземления
-        this->waiting_for_next_jump = false; // Ожидаем начала следующего прыжка
+        
+        this->fps = 0;
+        this->total_frames_trajectory = 0u;
+        this->period_frames = 1u;
         
         // const std::string path_file_hare =
         //     dir_img + "/hare.png";
@@ -81,116 +74,170 @@ namespace InSomnia
             hare_img_rgba_clear.cols * (
                 (float)target_height / hare_img_rgba_clear.rows));
         
-        // cv::Mat hare_img_ready;
+        cv::Mat hare_img_ready;
         
         cv::resize(
             hare_img_rgba_clear,
-            this->img,
+            hare_img_ready,
             cv::Size(target_width, target_height),
             0,
             0,
             cv::INTER_AREA);
+        
+        this->sprite = Sprite(hare_img_ready);
+        this->sprite_yuv = Yuv_Sprite(this->sprite);
     }
     
-    void Hare::render(
-        const uint32_t frame_idx,
-        const int fps,
-        cv::Mat &frame)
+    void Hare::build_trajectory(
+        const uint32_t total_frames,
+        const int fps)
     {
-        const double t_seconds =
-            static_cast<double>(frame_idx) / fps;
-        
-        // Определяем, должен ли начаться новый прыжок
-        if (!(this->is_in_air) &&
-            !(this->waiting_for_next_jump))
+        if (fps <= 0)
         {
-            // Первый прыжок начинаем сразу
-            this->is_in_air = true;
-            this->waiting_for_next_jump = false;
-            this->jump_start_x = this->current_x; // Начинаем прыжок с текущей позиции
-            this->last_landing_time = t_seconds; // Запоминаем время начала прыжка
+            throw std::runtime_error(
+                "Ошибка: неверная частота кадров для зайца\n");
         }
-        else if (!(this->is_in_air) && this->waiting_for_next_jump)
-        {
-            // Ожидаем задержку между прыжками
-            if (t_seconds - this->last_landing_time >= this->jump_interval)
+        
+        this->fps = fps;
+        this->total_frames_trajectory = total_frames;
+        this->jumps.clear();
+        
+        // Время кадра считается так же, как в покадровом автомате:
+        // frame / fps, а промежутки — разностью таких времён,
+        // поэтому и границы прыжков совпадают до кадра
+        const auto seconds_between =
+            [fps](const uint32_t frame_begin, const uint32_t frame_end)
             {
-                // Задержка прошла, начинаем новый прыжок
-                this->is_in_air = true;
-                this->waiting_for_next_jump = false;
-                this->jump_start_x = this->current_x; // Начинаем прыжок с текущей позиции
-                this->last_landing_time = t_seconds; // Обновляем время начала прыжка
-            }
-        }
+                return
+                    static_cast<double>(frame_end) / fps -
+                    static_cast<double>(frame_begin) / fps;
+            };
+        
+        // Приземление — первый кадр, где прыжок длится дольше
+        // jump_duration; следующий взлёт — первый кадр после
+        // приземления, когда прошло не меньше jump_interval
+        const uint32_t frames_air = static_cast<uint32_t>(
+            std::max(0.0, std::floor(this->jump_duration * fps))) + 1u;
+        const uint32_t frames_wait = std::max(1u, static_cast<uint32_t>(
+            std::max(0.0, std::ceil(this->jump_interval * fps))));
+        
+        this->period_frames = frames_air + frames_wait;
+        
+        double x = this->start_x;
+        uint32_t frame_start = 0u;
         
-        if (this->is_in_air)
+        while (frame_start < total_frames)
         {
-            // Время от начала прыжка
-            double jump_time = t_seconds - this->last_landing_time;
+            // Оценка по периоду уточняется на кадр в ту или другую
+            // сторону, если округление времени легло иначе
+            uint32_t frame_landing = frame_start + frames_air;
+            while (frame_landing > frame_start + 1u &&
+                   seconds_between(frame_start, frame_landing - 1u) >
+                       this->jump_duration)
+            {
+                --frame_landing;
+            }
+            while (!(seconds_between(frame_start, frame_landing) >
+                         this->jump_duration))
+            {
+                ++frame_landing;
+            }
             
-            // Ограничиваем время прыжка
-            if (jump_time > this->jump_duration)
+            uint32_t frame_next = frame_landing + frames_wait;
+            while (frame_next > frame_landing + 1u &&
+                   seconds_between(frame_landing, frame_next - 1u) >=
+                       this->jump_interval)
             {
-                // Прыжок закончен, приземляемся
-                jump_time = this->jump_duration;
-                
-                // Вычисляем финальную позицию после прыжка
-                const double x =
-                    this->jump_start_x + this->vx_per_jump * this->jump_duration;
-                double y =
-                    this->ground_y +
-                    this->vy_initial * this->jump_duration +
-                    0.5 * this->g_pixels_per_sec_sq *
-                    this->jump_duration * this->jump_duration;
-                
-                // Корректируем позицию приземления
-                if (y > this->ground_y)
-                {
-                    y = this->ground_y;
-                }
-                
-                // Обновляем текущую позицию
-                this->current_x = x;
-                this->current_y = y;
-                
-                // Переходим в состояние ожидания следующего прыжка
-                this->is_in_air = false;
-                this->waiting_for_next_jump = true;
-                this->last_landing_time = t_seconds; // Запоминаем время приземления для отсчёта задержки
-                
-                // Рисуем зайца в точке приземления
-                InSomnia::draw_figure_to_frame(
-                    this->img, this->current_x, this->current_y, frame);
+                --frame_next;
             }
-            else
+            while (seconds_between(frame_landing, frame_next) <
+                       this->jump_interval)
             {
-                // Прыжок в процессе
-                // Вычисляем текущую позицию
-                const double x =
-                    this->jump_start_x + this->vx_per_jump * jump_time;
-                double y =
-                    this->ground_y +
-                    this->vy_initial * jump_time +
-                    0.5 * this->g_pixels_per_sec_sq * jump_time * jump_time;
-                
-                // Корректируем позицию, если ниже земли
-                if (y > this->ground_y)
-                {
-                    y = this->ground_y;
-                }
-                
-                // Рисуем зайца в текущей позиции прыжка
-                InSomnia::draw_figure_to_frame(
-                    this->img, x, y, frame);
+                ++frame_next;
             }
+            
+            this->jumps.push_back({ frame_start, frame_landing, x });
+            
+            // Следующий прыжок — с точки приземления
+            x = x + this->vx_per_jump * this->jump_duration;
+            frame_start = frame_next;
         }
-        else
+    }
+    
+    double Hare::get_jump_y(const double jump_time) const
+    {
+        const double y =
+            this->ground_y +
+            this->vy_initial * jump_time +
+            0.5 * this->g_pixels_per_sec_sq * jump_time * jump_time;
+        
+        // Корректируем позицию, если ниже земли
+        return std::min(y, this->ground_y);
+    }
+    
+    cv::Point2d Hare::get_position(const uint32_t frame_idx) const
+    {
+        if (frame_idx >= this->total_frames_trajectory)
+        {
+            throw std::runtime_error(
+                "Ошибка: кадр вне траектории зайца, "
+                "нужен build_trajectory\n");
+        }
+        
+        // Номер прыжка по периоду, сдвиги округления
+        // поправляются соседними записями
+        const uint32_t count_jumps = this->jumps.size();
+        uint32_t idx = std::min(
+            frame_idx / this->period_frames, count_jumps - 1u);
+        
+        while (idx > 0u && this->jumps[idx].frame_start > frame_idx)
+        {
+            --idx;
+        }
+        while (idx + 1u < count_jumps &&
+               this->jumps[idx + 1u].frame_start <= frame_idx)
+        {
+            ++idx;
+        }
+        
+        const Hare_Jump &jump = this->jumps[idx];
+        
+        // Заяц приземлился и ждёт следующего прыжка
+        if (frame_idx >= jump.frame_landing)
         {
-            // Заяц на земле, ожидает начала следующего прыжка
-            InSomnia::draw_figure_to_frame(
-                this->img, this->current_x, this->current_y, frame);
+            return cv::Point2d(
+                jump.start_x + this->vx_per_jump * this->jump_duration,
+                this->get_jump_y(this->jump_duration));
         }
         
+        // Время от начала прыжка
+        const double jump_time =
+            static_cast<double>(frame_idx) / this->fps -
+            static_cast<double>(jump.frame_start) / this->fps;
+        
+        return cv::Point2d(
+            jump.start_x + this->vx_per_jump * jump_time,
+            this->get_jump_y(jump_time));
+    }
+    
+    void Hare::render(
+        const uint32_t frame_idx,
+        cv::Mat &frame) const
+    {
+        const cv::Point2d pos = this->get_position(frame_idx);
+        
+        InSomnia::draw_sprite_to_frame(
+            this->sprite, pos.x, pos.y, frame);
+    }
+    
+    void Hare::render(
+        const uint32_t frame_idx,
+        Frame_Yuv420 &frame) const
+    {
+        const cv::Point2d pos = this->get_position(frame_idx);
+        
+        InSomnia::draw_sprite_to_frame(
+            this->sprite_yuv, pos.x, pos.y, frame);
     }
     
 }
@@ -3,13 +3,25 @@
 
 #include <string>
 #include <limits>
+#include <vector>
 
 #include <opencv2/opencv.hpp>
 
 #include "toolbox.h"
+#include "sprite.h"
+#include "yuv_sprite.h"
 
 namespace InSomnia
 {
+    // Один прыжок зайца: взлёт на кадре frame_start, приземление
+    // на кадре frame_landing, затем ожидание до следующего взлёта
+    struct Hare_Jump
+    {
+        uint32_t frame_start;
+        uint32_t frame_landing;
+        double start_x;
+    };
+    
     class Hare
     {
     public:
@@ -27,28 +39,51 @@ namespace InSomnia
             const double start_x,
             const double jump_interval);
         
+        // Таблица прыжков на всё видео: кадры взлёта и приземления
+        // следуют из периода jump_duration + jump_interval
+        // с округлением до кадров, как в прежнем покадровом автомате
+        void build_trajectory(
+            const uint32_t total_frames,
+            const int fps);
+        
+        // Позиция на любом кадре без прохода по предыдущим,
+        // после build_trajectory
+        cv::Point2d get_position(const uint32_t frame_idx) const;
+        
+        // Кадры можно рисовать в любом порядке и из разных потоков
+        void render(
+            const uint32_t frame_idx,
+            cv::Mat &frame) const;
+        
         void render(
             const uint32_t frame_idx,
-            const int fps,
-            cv::Mat &frame);
+            Frame_Yuv420 &frame) const;
         
     private:
-        cv::Mat img;
+        Sprite sprite;
+        Yuv_Sprite sprite_yuv;
         
         double g_pixels_per_sec_sq; // Ускорение "гравитации"
         double vx_per_jump; // Скорость вперёд за прыжок (пикс/сек)
         double vy_initial; // Начальная скорость вверх (пикс/сек)
         double ground_y; // Уровень "земли"
-        
-        double current_x; // Начальная позиция X
-        double current_y; // Начальная позиция Y (на земле)
-        bool is_in_air; // Находится ли заяц в воздухе?
+        double start_x; // Начальная позиция X
         
         double jump_duration; // Длительность одного прыжка
         double jump_interval; // Задержка между прыжками (сек)
-        double jump_start_x; // Позиция начала текущего прыжка
-        double last_landing_time; // Время последнего приземления
-        bool waiting_for_next_jump; // Ожидаем начала следующего прыжка
+        
+        int fps;
+        uint32_t total_frames_trajectory;
+        
+        // Прыжки по возрастанию frame_start, первый — на кадре 0
+        std::vector<Hare_Jump> jumps;
+        
+        // Кадров от взлёта до взлёта (у всех прыжков, кроме
+        // редких сдвигов на кадр из-за округления)
+        uint32_t period_frames;
+        
+        // Высота над землёй в момент jump_time от взлёта
+        double get_jump_y(const double jump_time) const;
     };
 }
 
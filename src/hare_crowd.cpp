@@ -0,0 +1,283 @@
+#include "hare_crowd.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <random>
+#include <tuple>
+
+namespace InSomnia
+{
+    // Загружает hare.png так же, как Hare, и уменьшает
+    // до корзин масштаба, равномерных в логарифмической шкале
+    static std::shared_ptr<const Hare_Crowd_Sprites> build_sprites(
+        const std::string &path_file_hare,
+        const int height,
+        const uint32_t count_buckets,
+        const float scale_min,
+        const float scale_max)
+    {
+        const cv::Mat hare_img =
+            cv::imread(path_file_hare, cv::IMREAD_UNCHANGED);
+        
+        if (hare_img.empty())
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось загрузить файл hare.png\n");
+        }
+        
+        const cv::Mat hare_img_rgba_clear =
+            InSomnia::clear_alpha(InSomnia::convert_to_rgba(hare_img));
+        
+        std::shared_ptr<Hare_Crowd_Sprites> sprites =
+            std::make_shared<Hare_Crowd_Sprites>();
+        
+        for (uint32_t i = 0u; i < count_buckets; ++i)
+        {
+            const float t = count_buckets > 1u ?
+                static_cast<float>(i) / (count_buckets - 1) : 1.f;
+            const float scale =
+                scale_min * std::pow(scale_max / scale_min, t);
+            
+            const int target_height =
+                std::max(1, static_cast<int>(height * scale));
+            const int target_width = std::max(1, static_cast<int>(
+                hare_img_rgba_clear.cols * (
+                    (float)target_height / hare_img_rgba_clear.rows)));
+            
+            cv::Mat resized;
+            cv::resize(
+                hare_img_rgba_clear,
+                resized,
+                cv::Size(target_width, target_height),
+                0,
+                0,
+                cv::INTER_AREA);
+            
+            sprites->bucket_scales.push_back(scale);
+            sprites->sprites.push_back(Sprite(resized));
+            sprites->sprites_yuv.push_back(
+                Yuv_Sprite(sprites->sprites.back()));
+        }
+        
+        return sprites;
+    }
+    
+    // Общий набор, пока на него есть ссылки,
+    // как Snowflake_Sprite_Cache::get_shared
+    static std::shared_ptr<const Hare_Crowd_Sprites> get_shared_sprites(
+        const std::string &path_file_hare,
+        const int height,
+        const uint32_t count_buckets,
+        const float scale_min,
+        const float scale_max)
+    {
+        using Key = std::tuple<std::string, int, uint32_t, float, float>;
+        
+        static std::mutex mutex;
+        static std::map<
+            Key, std::weak_ptr<const Hare_Crowd_Sprites>> registry;
+        
+        const Key key(
+            path_file_hare, height, count_buckets, scale_min, scale_max);
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        std::shared_ptr<const Hare_Crowd_Sprites> sprites =
+            registry[key].lock();
+        
+        if (!sprites)
+        {
+            sprites = build_sprites(
+                path_file_hare, height, count_buckets, scale_min, scale_max);
+            registry[key] = sprites;
+        }
+        
+        return sprites;
+    }
+    
+    Hare_Crowd::Hare_Crowd()
+    {
+        this->fps = 0;
+        this->g_pixels_per_sec_sq = 0.0;
+        this->vy_initial = 0.0;
+        this->jump_duration = 0.0;
+        this->x_wrap_begin = 0.f;
+        this->x_wrap_span = 1.f;
+    }
+    
+    Hare_Crowd::Hare_Crowd(
+        const std::string &path_file_hare,
+        const int width,
+        const int height,
+        const uint32_t count_actors,
+        const uint32_t count_buckets,
+        const float scale_min,
+        const float scale_max,
+        const double g_pixels_per_sec_sq,
+        const double vx_per_jump,
+        const double vy_initial,
+        const double ground_y_min,
+        const double ground_y_max,
+        const double jump_interval_min,
+        const double jump_interval_max,
+        const int fps,
+        const uint64_t seed)
+    {
+        if (count_buckets == 0u || count_buckets > 0xFFFFu ||
+            scale_min <= 0.f || scale_min > scale_max ||
+            fps <= 0 || g_pixels_per_sec_sq <= 0.0 || vy_initial >= 0.0)
+        {
+            throw std::runtime_error(
+                "Ошибка: неверные параметры стаи зайцев\n");
+        }
+        
+        this->sprites = get_shared_sprites(
+            path_file_hare, height, count_buckets, scale_min, scale_max);
+        
+        this->fps = fps;
+        this->g_pixels_per_sec_sq = g_pixels_per_sec_sq;
+        this->vy_initial = vy_initial;
+        
+        // Высота прыжка пропорциональна масштабу при общих g и vy,
+        // поэтому и длительность прыжка у всех одна
+        this->jump_duration = 2.0 * (-vy_initial) / g_pixels_per_sec_sq;
+        
+        const int width_sprite_max =
+            this->sprites->sprites.back().get_width();
+        this->x_wrap_begin = -width_sprite_max;
+        this->x_wrap_span = width + 2 * width_sprite_max;
+        
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<float> dist_unit(0.f, 1.f);
+        
+        // Глубина 0 — дальний край (ground_y_min, scale_min)
+        std::vector<float> depths(count_actors);
+        for (float &depth : depths)
+        {
+            depth = dist_unit(gen);
+        }
+        std::sort(depths.begin(), depths.end());
+        
+        this->start_x.resize(count_actors);
+        this->vx_per_jump.resize(count_actors);
+        this->jump_interval.resize(count_actors);
+        this->phase.resize(count_actors);
+        this->ground_y.resize(count_actors);
+        this->scale_jump.resize(count_actors);
+        this->idx_bucket.resize(count_actors);
+        
+        for (uint32_t i = 0u; i < count_actors; ++i)
+        {
+            const float depth = depths[i];
+            
+            const uint32_t bucket = count_buckets > 1u ?
+                static_cast<uint32_t>(std::lround(depth * (count_buckets - 1))) :
+                0u;
+            const float scale_rel =
+                this->sprites->bucket_scales[bucket] / scale_max;
+            
+            const float interval =
+                jump_interval_min +
+                (jump_interval_max - jump_interval_min) * dist_unit(gen);
+            
+            this->start_x[i] = this->x_wrap_begin +
+                this->x_wrap_span * dist_unit(gen);
+            // Разброс скорости, чтобы зайцы не шли строем
+            this->vx_per_jump[i] =
+                vx_per_jump * scale_rel * (0.7f + 0.6f * dist_unit(gen));
+            this->jump_interval[i] = interval;
+            this->phase[i] =
+                (this->jump_duration + interval) * dist_unit(gen);
+            this->ground_y[i] =
+                ground_y_min + (ground_y_max - ground_y_min) * depth;
+            this->scale_jump[i] = scale_rel;
+            this->idx_bucket[i] = static_cast<uint16_t>(bucket);
+        }
+        
+        this->vec_x.resize(count_actors);
+        this->vec_y.resize(count_actors);
+    }
+    
+    uint32_t Hare_Crowd::size() const
+    {
+        return this->start_x.size();
+    }
+    
+    void Hare_Crowd::evaluate_positions(const uint32_t frame_idx)
+    {
+        const uint32_t count = this->size();
+        
+        const float t_seconds = static_cast<float>(frame_idx) / this->fps;
+        const float duration = this->jump_duration;
+        const float vy = this->vy_initial;
+        const float g = this->g_pixels_per_sec_sq;
+        
+        const float *start_x = this->start_x.data();
+        const float *vx = this->vx_per_jump.data();
+        const float *interval = this->jump_interval.data();
+        const float *phase = this->phase.data();
+        const float *ground_y = this->ground_y.data();
+        const float *scale_jump = this->scale_jump.data();
+        float *x = this->vec_x.data();
+        float *y = this->vec_y.data();
+        
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            // Прыжок k начинается в k * period, длится duration,
+            // затем заяц ждёт interval на земле
+            const float t_local = t_seconds + phase[i];
+            const float period = duration + interval[i];
+            const float k = std::floor(t_local / period);
+            const float jump_time = std::min(t_local - k * period, duration);
+            
+            const float x_run = start_x[i] + vx[i] * (k * duration + jump_time);
+            const float x_wrapped =
+                x_run - this->x_wrap_span * std::floor(
+                    (x_run - this->x_wrap_begin) / this->x_wrap_span);
+            
+            const float height_jump =
+                vy * jump_time + 0.5f * g * jump_time * jump_time;
+            
+            x[i] = x_wrapped;
+            y[i] = ground_y[i] + scale_jump[i] * std::min(height_jump, 0.f);
+        }
+    }
+    
+    void Hare_Crowd::render(
+        const uint32_t frame_idx,
+        cv::Mat &frame)
+    {
+        this->evaluate_positions(frame_idx);
+        
+        const uint32_t count = this->size();
+        
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            draw_sprite_to_frame(
+                this->sprites->sprites[this->idx_bucket[i]],
+                this->vec_x[i],
+                this->vec_y[i],
+                frame);
+        }
+    }
+    
+    void Hare_Crowd::render(
+        const uint32_t frame_idx,
+        Frame_Yuv420 &frame)
+    {
+        this->evaluate_positions(frame_idx);
+        
+        const uint32_t count = this->size();
+        
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            draw_sprite_to_frame(
+                this->sprites->sprites_yuv[this->idx_bucket[i]],
+                this->vec_x[i],
+                this->vec_y[i],
+                frame);
+        }
+    }
+    
+}
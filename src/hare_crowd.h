@@ -0,0 +1,97 @@
+#ifndef INSOMNIA_HARE_CROWD_H
+#define INSOMNIA_HARE_CROWD_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "toolbox.h"
+#include "sprite.h"
+#include "yuv_sprite.h"
+
+namespace InSomnia
+{
+    // Спрайты зайца, уменьшенные до каждой корзины масштаба.
+    // Один набор на все стаи и все сцены с теми же параметрами
+    struct Hare_Crowd_Sprites
+    {
+        std::vector<float> bucket_scales;
+        std::vector<Sprite> sprites;
+        std::vector<Yuv_Sprite> sprites_yuv;
+    };
+    
+    // Стая прыгающих зайцев на заднем плане. Параметры зайцев
+    // лежат массивами по полям, позиции всех зайцев считаются
+    // одним циклом по замкнутой формуле от периода прыжка,
+    // без состояния между кадрами. Зайцы упорядочены по глубине
+    // один раз при создании и рисуются за один проход от дальних
+    // к ближним. Дальние мельче, ниже прыгают и медленнее бегут;
+    // ушедший за правый край заяц возвращается слева
+    class Hare_Crowd
+    {
+    public:
+        Hare_Crowd();
+        
+        // vx_per_jump и vy_initial — у зайца масштаба scale_max,
+        // у остальных пропорционально масштабу
+        Hare_Crowd(
+            const std::string &path_file_hare,
+            const int width,
+            const int height,
+            const uint32_t count_actors,
+            const uint32_t count_buckets,
+            const float scale_min,
+            const float scale_max,
+            const double g_pixels_per_sec_sq,
+            const double vx_per_jump,
+            const double vy_initial,
+            const double ground_y_min,
+            const double ground_y_max,
+            const double jump_interval_min,
+            const double jump_interval_max,
+            const int fps,
+            const uint64_t seed);
+        
+        uint32_t size() const;
+        
+        // Позиции всех зайцев на кадре frame_idx в vec_x, vec_y
+        void evaluate_positions(const uint32_t frame_idx);
+        
+        void render(
+            const uint32_t frame_idx,
+            cv::Mat &frame);
+        
+        void render(
+            const uint32_t frame_idx,
+            Frame_Yuv420 &frame);
+        
+    private:
+        std::shared_ptr<const Hare_Crowd_Sprites> sprites;
+        
+        int fps;
+        double g_pixels_per_sec_sq;
+        double vy_initial;
+        double jump_duration; // Общая: у всех одна g / vy
+        
+        // Заяц уходит за край на ширину самого крупного спрайта
+        float x_wrap_begin;
+        float x_wrap_span;
+        
+        // По зайцу на элемент, от дальних к ближним
+        std::vector<float> start_x;
+        std::vector<float> vx_per_jump;
+        std::vector<float> jump_interval;
+        std::vector<float> phase; // Сдвиг по времени, сек
+        std::vector<float> ground_y;
+        std::vector<float> scale_jump; // Доля высоты прыжка
+        std::vector<uint16_t> idx_bucket;
+        
+        // Позиции на последнем evaluate_positions
+        std::vector<float> vec_x;
+        std::vector<float> vec_y;
+    };
+}
+
+#endif
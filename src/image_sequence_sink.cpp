@@ -0,0 +1,376 @@
+#include "image_sequence_sink.h"
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+
+namespace InSomnia
+{
+    using Clock = std::chrono::steady_clock;
+    
+    static double seconds_since(const Clock::time_point time_begin)
+    {
+        return std::chrono::duration<double>(Clock::now() - time_begin).count();
+    }
+    
+    Image_Sequence_Sink::Image_Sequence_Sink(
+        const std::string &path_dir,
+        const Image_Format format,
+        const uint32_t count_threads,
+        const uint32_t max_pending)
+    {
+        if (count_threads == 0u || max_pending == 0u)
+        {
+            throw std::runtime_error(
+                "Ошибка: Image_Sequence_Sink нужен хотя бы один поток\n");
+        }
+        
+        std::filesystem::create_directories(path_dir);
+        
+        this->path_dir = path_dir;
+        this->format = format;
+        this->max_pending = max_pending;
+        this->count_pending = 0u;
+        this->is_closed = false;
+        this->stats = Sink_Stats();
+        
+        this->threads.reserve(count_threads);
+        for (uint32_t i = 0u; i < count_threads; ++i)
+        {
+            this->threads.emplace_back(
+                &Image_Sequence_Sink::encode_loop, this);
+        }
+    }
+    
+    Image_Sequence_Sink::~Image_Sequence_Sink()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->is_closed = true;
+        }
+        this->cv_job.notify_all();
+        
+        for (std::thread &t : this->threads)
+        {
+            if (t.joinable())
+            {
+                t.join();
+            }
+        }
+    }
+    
+    void Image_Sequence_Sink::push(
+        const uint32_t frame_idx,
+        const cv::Mat &frame)
+    {
+        const Clock::time_point time_begin = Clock::now();
+        
+        std::unique_lock<std::mutex> lock(this->mutex);
+        
+        if (this->is_closed)
+        {
+            throw std::runtime_error(
+                "Ошибка: Image_Sequence_Sink уже закрыт\n");
+        }
+        
+        this->cv_done.wait(lock, [this]()
+        {
+            return
+                this->error ||
+                this->count_pending < this->max_pending;
+        });
+        
+        this->rethrow_error();
+        
+        ++(this->count_pending);
+        
+        Job job;
+        job.frame_idx = frame_idx;
+        if (!(this->free_frames.empty()))
+        {
+            job.frame = std::move(this->free_frames.back());
+            this->free_frames.pop_back();
+        }
+        lock.unlock();
+        
+        // Копия: после возврата из push буфер кадра снова
+        // принадлежит рендеру. Буфер копии того же размера
+        // переиспользуется без выделения памяти
+        frame.copyTo(job.frame);
+        
+        lock.lock();
+        this->jobs.push_back(std::move(job));
+        this->stats.seconds += seconds_since(time_begin);
+        lock.unlock();
+        
+        this->cv_job.notify_one();
+    }
+    
+    void Image_Sequence_Sink::flush()
+    {
+        const Clock::time_point time_begin = Clock::now();
+        
+        std::unique_lock<std::mutex> lock(this->mutex);
+        
+        this->cv_done.wait(lock, [this]()
+        {
+            return this->error || this->count_pending == 0u;
+        });
+        
+        this->stats.seconds += seconds_since(time_begin);
+        
+        this->rethrow_error();
+    }
+    
+    void Image_Sequence_Sink::close()
+    {
+        this->flush();
+        
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->is_closed = true;
+        }
+        this->cv_job.notify_all();
+        
+        for (std::thread &t : this->threads)
+        {
+            if (t.joinable())
+            {
+                t.join();
+            }
+        }
+    }
+    
+    Sink_Stats Image_Sequence_Sink::get_stats() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->stats;
+    }
+    
+    void Image_Sequence_Sink::encode_loop()
+    {
+        const std::string extension =
+            this->format == Image_Format::png ? "png" : "qoi";
+        
+        std::vector<uint8_t> encoded;
+        
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->cv_job.wait(lock, [this]()
+                {
+                    return this->is_closed || !(this->jobs.empty());
+                });
+                
+                if (this->jobs.empty())
+                {
+                    return;
+                }
+                
+                job = std::move(this->jobs.front());
+                this->jobs.pop_front();
+            }
+            
+            try
+            {
+                if (this->format == Image_Format::png)
+                {
+                    // Быстрое сжатие: размер чуть больше, время в разы меньше
+                    const std::vector<int> params =
+                    {
+                        cv::IMWRITE_PNG_COMPRESSION, 1
+                    };
+                    
+                    if (!cv::imencode(".png", job.frame, encoded, params))
+                    {
+                        throw std::runtime_error(
+                            "Ошибка: не удалось сжать кадр в PNG\n");
+                    }
+                }
+                else
+                {
+                    encode_qoi(job.frame, encoded);
+                }
+                
+                const std::string path_file =
+                    (std::filesystem::path(this->path_dir) /
+                     std::format("frame_{:06}.{}", job.frame_idx, extension))
+                    .string();
+                
+                std::ofstream file(path_file, std::ios::binary);
+                file.write(
+                    reinterpret_cast<const char*>(encoded.data()),
+                    encoded.size());
+                
+                if (!file)
+                {
+                    throw std::runtime_error(
+                        "Ошибка: не удалось записать " + path_file + "\n");
+                }
+                
+                std::lock_guard<std::mutex> lock(this->mutex);
+                ++(this->stats.count_frames);
+                this->stats.bytes_written += encoded.size();
+                this->free_frames.push_back(std::move(job.frame));
+                --(this->count_pending);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                if (!(this->error))
+                {
+                    this->error = std::current_exception();
+                }
+                --(this->count_pending);
+            }
+            
+            this->cv_done.notify_all();
+        }
+    }
+    
+    void Image_Sequence_Sink::rethrow_error()
+    {
+        // Вызывается под mutex
+        if (this->error)
+        {
+            std::rethrow_exception(this->error);
+        }
+    }
+    
+    void encode_qoi(
+        const cv::Mat &frame,
+        std::vector<uint8_t> &out)
+    {
+        if (frame.type() != CV_8UC3)
+        {
+            throw std::runtime_error(
+                "Ошибка: QOI ожидает кадр CV_8UC3\n");
+        }
+        
+        const uint32_t width = frame.cols;
+        const uint32_t height = frame.rows;
+        
+        // Худший случай — QOI_OP_RGB на каждый пиксель
+        out.resize(14 + 4u * width * height + 8);
+        uint8_t *p = out.data();
+        
+        auto put_u32 = [&p](const uint32_t v)
+        {
+            *p++ = v >> 24;
+            *p++ = v >> 16;
+            *p++ = v >> 8;
+            *p++ = v;
+        };
+        
+        // Заголовок: магия, размер, 3 канала, sRGB
+        *p++ = 'q';
+        *p++ = 'o';
+        *p++ = 'i';
+        *p++ = 'f';
+        put_u32(width);
+        put_u32(height);
+        *p++ = 3;
+        *p++ = 0;
+        
+        // Альфа всегда 255, поэтому в хеше и сравнениях
+        // участвуют только r, g, b
+        uint32_t index[64] = {};
+        uint8_t prev_r = 0;
+        uint8_t prev_g = 0;
+        uint8_t prev_b = 0;
+        uint32_t run = 0u;
+        
+        for (uint32_t y = 0u; y < height; ++y)
+        {
+            const uint8_t *src = frame.ptr<uint8_t>(y);
+            const bool is_last_row = (y + 1 == height);
+            
+            for (uint32_t x = 0u; x < width; ++x)
+            {
+                const uint8_t b = src[3 * x];
+                const uint8_t g = src[3 * x + 1];
+                const uint8_t r = src[3 * x + 2];
+                
+                if (r == prev_r && g == prev_g && b == prev_b)
+                {
+                    ++run;
+                    if (run == 62u || (is_last_row && x + 1 == width))
+                    {
+                        *p++ = 0xc0 | (run - 1); // QOI_OP_RUN
+                        run = 0u;
+                    }
+                    continue;
+                }
+                
+                if (run > 0u)
+                {
+                    *p++ = 0xc0 | (run - 1);
+                    run = 0u;
+                }
+                
+                const uint32_t pixel =
+                    (static_cast<uint32_t>(r) << 24) |
+                    (static_cast<uint32_t>(g) << 16) |
+                    (static_cast<uint32_t>(b) << 8) | 0xff;
+                const uint32_t index_pos =
+                    (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+                
+                if (index[index_pos] == pixel)
+                {
+                    *p++ = index_pos; // QOI_OP_INDEX
+                }
+                else
+                {
+                    index[index_pos] = pixel;
+                    
+                    const int8_t dr = static_cast<int8_t>(r - prev_r);
+                    const int8_t dg = static_cast<int8_t>(g - prev_g);
+                    const int8_t db = static_cast<int8_t>(b - prev_b);
+                    const int8_t dr_dg = static_cast<int8_t>(dr - dg);
+                    const int8_t db_dg = static_cast<int8_t>(db - dg);
+                    
+                    if (dr > -3 && dr < 2 &&
+                        dg > -3 && dg < 2 &&
+                        db > -3 && db < 2)
+                    {
+                        // QOI_OP_DIFF
+                        *p++ = 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+                    }
+                    else if (dr_dg > -9 && dr_dg < 8 &&
+                             dg > -33 && dg < 32 &&
+                             db_dg > -9 && db_dg < 8)
+                    {
+                        // QOI_OP_LUMA
+                        *p++ = 0x80 | (dg + 32);
+                        *p++ = (dr_dg + 8) << 4 | (db_dg + 8);
+                    }
+                    else
+                    {
+                        // QOI_OP_RGB
+                        *p++ = 0xfe;
+                        *p++ = r;
+                        *p++ = g;
+                        *p++ = b;
+                    }
+                }
+                
+                prev_r = r;
+                prev_g = g;
+                prev_b = b;
+            }
+        }
+        
+        // Конец потока: семь нулей и единица
+        for (int i = 0; i < 7; ++i)
+        {
+            *p++ = 0;
+        }
+        *p++ = 1;
+        
+        out.resize(p - out.data());
+    }
+    
+}
@@ -0,0 +1,88 @@
+#ifndef INSOMNIA_IMAGE_SEQUENCE_SINK_H
+#define INSOMNIA_IMAGE_SEQUENCE_SINK_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame_sink.h"
+
+namespace InSomnia
+{
+    enum class Image_Format
+    {
+        png,
+        qoi
+    };
+    
+    // Кадры в отдельные файлы dir/frame_000000.png (.qoi).
+    // Кадры сжимаются параллельно в count_threads потоках;
+    // push копирует кадр и ждёт, только если в работе уже
+    // max_pending кадров
+    class Image_Sequence_Sink : public Frame_Sink
+    {
+    public:
+        Image_Sequence_Sink(
+            const std::string &path_dir,
+            const Image_Format format,
+            const uint32_t count_threads,
+            const uint32_t max_pending);
+        
+        ~Image_Sequence_Sink() override;
+        
+        Image_Sequence_Sink(const Image_Sequence_Sink &) = delete;
+        Image_Sequence_Sink& operator=(const Image_Sequence_Sink &) = delete;
+        
+        void push(
+            const uint32_t frame_idx,
+            const cv::Mat &frame) override;
+        
+        // Ждёт, пока все принятые кадры окажутся на диске
+        void flush() override;
+        
+        void close() override;
+        
+        Sink_Stats get_stats() const override;
+        
+    private:
+        struct Job
+        {
+            uint32_t frame_idx;
+            cv::Mat frame;
+        };
+        
+        std::string path_dir;
+        Image_Format format;
+        uint32_t max_pending;
+        
+        std::vector<std::thread> threads;
+        
+        mutable std::mutex mutex;
+        std::condition_variable cv_job;  // Появилась работа или закрытие
+        std::condition_variable cv_done; // Кадр записан
+        std::deque<Job> jobs;
+        std::vector<cv::Mat> free_frames; // Буферы копий для повторного использования
+        uint32_t count_pending; // В очереди и в работе
+        bool is_closed;
+        std::exception_ptr error;
+        
+        Sink_Stats stats;
+        
+        void encode_loop();
+        
+        void rethrow_error();
+    };
+    
+    // QOI (qoiformat.org) для BGR-кадра: быстрое сжатие без потерь
+    void encode_qoi(
+        const cv::Mat &frame,
+        std::vector<uint8_t> &out);
+}
+
+#endif
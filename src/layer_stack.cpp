@@ -0,0 +1,275 @@
+#include "layer_stack.h"
+
+namespace InSomnia
+{
+    Layer_Stack::Layer_Stack()
+    {
+        this->width = 0;
+        this->height = 0;
+        this->type = CV_8UC3;
+        this->is_valid = false;
+        this->is_valid_yuv = false;
+        this->count_background_layers = 0u;
+    }
+    
+    Layer_Stack::Layer_Stack(
+        const int width,
+        const int height,
+        const int type)
+    {
+        if (type != CV_8UC3)
+        {
+            throw std::runtime_error(
+                "Ошибка: Layer_Stack поддерживает только CV_8UC3\n");
+        }
+        
+        this->width = width;
+        this->height = height;
+        this->type = type;
+        this->is_valid = false;
+        this->is_valid_yuv = false;
+        this->count_background_layers = 0u;
+    }
+    
+    void Layer_Stack::add_layer(
+        const std::string &name,
+        const Layer_Kind kind,
+        const Layer_Render_Function &render)
+    {
+        this->add_layer(name, kind, render, Layer_Render_Yuv_Function());
+    }
+    
+    void Layer_Stack::add_layer(
+        const std::string &name,
+        const Layer_Kind kind,
+        const Layer_Render_Function &render,
+        const Layer_Render_Yuv_Function &render_yuv)
+    {
+        this->layers.push_back({ name, kind, render, render_yuv });
+        
+        this->invalidate();
+    }
+    
+    bool Layer_Stack::supports_yuv() const
+    {
+        for (const Layer &layer : this->layers)
+        {
+            if (layer.kind == Layer_Kind::dynamic_layer && !layer.render_yuv)
+            {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    void Layer_Stack::invalidate()
+    {
+        this->is_valid = false;
+        this->is_valid_yuv = false;
+    }
+    
+    void Layer_Stack::render(
+        const uint32_t frame_idx,
+        cv::Mat &frame)
+    {
+        if (!(this->is_valid))
+        {
+            this->rebuild(frame_idx);
+        }
+        
+        this->background.copyTo(frame);
+        
+        const uint32_t count_layers = this->layers.size();
+        
+        for (uint32_t i = this->count_background_layers;
+             i < count_layers;
+             ++i)
+        {
+            const Layer &layer = this->layers[i];
+            
+            if (layer.kind == Layer_Kind::dynamic_layer)
+            {
+                layer.render(frame_idx, frame);
+                continue;
+            }
+            
+            // Статические слои внутри серии уже запечены
+            // в наложение её первого слоя
+            const int32_t idx_overlay = this->vec_idx_overlay[i];
+            if (idx_overlay >= 0)
+            {
+                draw_sprite_to_frame(
+                    this->overlays[idx_overlay],
+                    this->width / 2.f,
+                    this->height / 2.f,
+                    frame);
+            }
+        }
+    }
+    
+    void Layer_Stack::render(
+        const uint32_t frame_idx,
+        Frame_Yuv420 &frame)
+    {
+        if (!(this->is_valid))
+        {
+            this->rebuild(frame_idx);
+        }
+        
+        if (!(this->is_valid_yuv))
+        {
+            this->rebuild_yuv();
+        }
+        
+        Frame_Yuv420 background(this->background_yuv);
+        background.get_y().copyTo(frame.get_y());
+        background.get_u().copyTo(frame.get_u());
+        background.get_v().copyTo(frame.get_v());
+        
+        const uint32_t count_layers = this->layers.size();
+        
+        for (uint32_t i = this->count_background_layers;
+             i < count_layers;
+             ++i)
+        {
+            const Layer &layer = this->layers[i];
+            
+            if (layer.kind == Layer_Kind::dynamic_layer)
+            {
+                if (!(layer.render_yuv))
+                {
+                    throw std::runtime_error(
+                        "Ошибка: слой " + layer.name +
+                        " не умеет рисовать в YUV\n");
+                }
+                
+                layer.render_yuv(frame_idx, frame);
+                continue;
+            }
+            
+            const int32_t idx_overlay = this->vec_idx_overlay[i];
+            if (idx_overlay >= 0)
+            {
+                draw_sprite_to_frame(
+                    this->overlays_yuv[idx_overlay],
+                    this->width / 2.f,
+                    this->height / 2.f,
+                    frame);
+            }
+        }
+    }
+    
+    void Layer_Stack::rebuild_yuv()
+    {
+        cv::cvtColor(
+            this->background, this->background_yuv, cv::COLOR_BGR2YUV_I420);
+        
+        this->overlays_yuv.clear();
+        for (const Sprite &overlay : this->overlays)
+        {
+            this->overlays_yuv.push_back(Yuv_Sprite(overlay));
+        }
+        
+        this->is_valid_yuv = true;
+    }
+    
+    void Layer_Stack::rebuild(const uint32_t frame_idx)
+    {
+        const uint32_t count_layers = this->layers.size();
+        
+        // Фон: статические слои до первого динамического
+        this->count_background_layers = 0u;
+        while (this->count_background_layers < count_layers &&
+               this->layers[this->count_background_layers].kind ==
+                   Layer_Kind::static_layer)
+        {
+            ++(this->count_background_layers);
+        }
+        
+        this->background =
+            cv::Mat::zeros(this->height, this->width, this->type);
+        
+        for (uint32_t i = 0u; i < this->count_background_layers; ++i)
+        {
+            this->layers[i].render(frame_idx, this->background);
+        }
+        
+        // Наложения: серии статических слоёв выше динамических
+        this->vec_idx_overlay.assign(count_layers, -1);
+        this->overlays.clear();
+        
+        uint32_t i = this->count_background_layers;
+        while (i < count_layers)
+        {
+            if (this->layers[i].kind == Layer_Kind::dynamic_layer)
+            {
+                ++i;
+                continue;
+            }
+            
+            uint32_t idx_end = i + 1;
+            while (idx_end < count_layers &&
+                   this->layers[idx_end].kind == Layer_Kind::static_layer)
+            {
+                ++idx_end;
+            }
+            
+            this->vec_idx_overlay[i] = this->overlays.size();
+            this->overlays.push_back(
+                this->bake_overlay(frame_idx, i, idx_end));
+            
+            i = idx_end;
+        }
+        
+        this->is_valid = true;
+        this->is_valid_yuv = false;
+    }
+    
+    Sprite Layer_Stack::bake_overlay(
+        const uint32_t frame_idx,
+        const uint32_t idx_begin,
+        const uint32_t idx_end) const
+    {
+        // Рисуем серию на чёрном и на белом фоне:
+        // на чёрном получаем цвет, умноженный на альфу,
+        // разница белого и чёрного даёт 255 - alpha
+        cv::Mat on_black(
+            this->height, this->width, this->type, cv::Scalar(0, 0, 0));
+        cv::Mat on_white(
+            this->height, this->width, this->type, cv::Scalar(255, 255, 255));
+        
+        for (uint32_t i = idx_begin; i < idx_end; ++i)
+        {
+            this->layers[i].render(frame_idx, on_black);
+            this->layers[i].render(frame_idx, on_white);
+        }
+        
+        cv::Mat premultiplied(this->height, this->width, CV_8UC4);
+        
+        for (int y = 0; y < this->height; ++y)
+        {
+            const cv::Vec3b *b = on_black.ptr<cv::Vec3b>(y);
+            const cv::Vec3b *w = on_white.ptr<cv::Vec3b>(y);
+            cv::Vec4b *dst = premultiplied.ptr<cv::Vec4b>(y);
+            
+            for (int x = 0; x < this->width; ++x)
+            {
+                int transparency = 0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    transparency = std::max(
+                        transparency,
+                        static_cast<int>(w[x][c]) - b[x][c]);
+                }
+                
+                dst[x] = cv::Vec4b(
+                    b[x][0], b[x][1], b[x][2],
+                    static_cast<uchar>(255 - transparency));
+            }
+        }
+        
+        return Sprite(premultiplied, true);
+    }
+    
+}
@@ -0,0 +1,116 @@
+#ifndef INSOMNIA_LAYER_STACK_H
+#define INSOMNIA_LAYER_STACK_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "sprite.h"
+#include "yuv_sprite.h"
+#include "frame_yuv420.h"
+
+namespace InSomnia
+{
+    enum class Layer_Kind
+    {
+        static_layer,  // одинаковый на всех кадрах, рисуется один раз
+        dynamic_layer  // меняется от кадра к кадру
+    };
+    
+    using Layer_Render_Function = std::function<
+        void(const uint32_t frame_idx, cv::Mat &frame)>;
+    
+    using Layer_Render_Yuv_Function = std::function<
+        void(const uint32_t frame_idx, Frame_Yuv420 &frame)>;
+    
+    struct Layer
+    {
+        std::string name;
+        Layer_Kind kind;
+        Layer_Render_Function render;
+        Layer_Render_Yuv_Function render_yuv; // Может быть пустой
+    };
+    
+    // Слои кадра снизу вверх с кешем статических слоёв.
+    // Статические слои под всеми динамическими запекаются в фон,
+    // с которого начинается каждый кадр. Статические слои выше
+    // динамических (ёлка над сугробом и снегопадом) запекаются
+    // в спрайт-наложение и рисуются на своём месте в порядке слоёв.
+    class Layer_Stack
+    {
+    public:
+        Layer_Stack();
+        
+        Layer_Stack(
+            const int width,
+            const int height,
+            const int type);
+        
+        // Слои добавляются снизу вверх
+        void add_layer(
+            const std::string &name,
+            const Layer_Kind kind,
+            const Layer_Render_Function &render);
+        
+        // Слой, который умеет рисовать и в кадр YUV 4:2:0.
+        // Статическим слоям это не нужно: они запекаются в BGR
+        // и переводятся в YUV один раз
+        void add_layer(
+            const std::string &name,
+            const Layer_Kind kind,
+            const Layer_Render_Function &render,
+            const Layer_Render_Yuv_Function &render_yuv);
+        
+        // Все динамические слои умеют рисовать в YUV
+        bool supports_yuv() const;
+        
+        // Сбрасывает кеш: статические слои будут перерисованы
+        // на следующем кадре (например, после их изменения)
+        void invalidate();
+        
+        void render(
+            const uint32_t frame_idx,
+            cv::Mat &frame);
+        
+        void render(
+            const uint32_t frame_idx,
+            Frame_Yuv420 &frame);
+        
+    private:
+        int width;
+        int height;
+        int type;
+        
+        std::vector<Layer> layers;
+        
+        bool is_valid;
+        
+        // Готовый фон из нижних статических слоёв
+        cv::Mat background;
+        uint32_t count_background_layers;
+        
+        // Для первого слоя каждой серии статических слоёв
+        // над динамическими — индекс наложения, иначе -1
+        std::vector<int32_t> vec_idx_overlay;
+        std::vector<Sprite> overlays;
+        
+        // Те же фон и наложения для кадра YUV 4:2:0,
+        // строятся при первом таком кадре
+        bool is_valid_yuv;
+        cv::Mat background_yuv; // Буфер I420
+        std::vector<Yuv_Sprite> overlays_yuv;
+        
+        void rebuild(const uint32_t frame_idx);
+        
+        void rebuild_yuv();
+        
+        Sprite bake_overlay(
+            const uint32_t frame_idx,
+            const uint32_t idx_begin,
+            const uint32_t idx_end) const;
+    };
+}
+
+#endif
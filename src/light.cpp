@@ -1,5 +1,7 @@
 #include "light.h"
 
+#include "compositor.h"
+
 namespace InSomnia
 {
     Light::Light()
@@ -9,9 +11,13 @@ namespace InSomnia
         
         this->count_colors          = -1;
         this->count_state_lamps     = -1;
+        this->width                 = 0;
+        this->height                = 0;
         this->diagonal              = nan;
         this->radius_base           = nan;
-        this->num_mode              = -1;
+        this->total_frames_timeline = 0u;
+        this->idx_radius_maps       = UINT32_MAX;
+        this->idx_radius_maps_yuv   = UINT32_MAX;
     }
     
     Light::Light(
@@ -48,59 +54,99 @@ namespace InSomnia
             state.limit_frames = state.duration * fps;
         }
         
+        this->width = width;
+        this->height = height;
+        
         this->diagonal = std::sqrt(
             width * width + height * height);
         
         this->radius_base = diagonal * scale; // 0.003
         
-        this->num_mode = 0u;
+        this->total_frames_timeline = 0u;
+        this->idx_radius_maps = UINT32_MAX;
+        this->idx_radius_maps_yuv = UINT32_MAX;
+    }
+    
+    void Light::generate_lights_inside_tree_by_alpha(
+        const int num_lights,
+        const uint64_t seed)
+    {
+        this->generate_lights_inside_tree_by_alpha(
+            num_lights, seed, Lamp_Placement::uniform);
     }
     
     void Light::generate_lights_inside_tree_by_alpha(
-        const int num_lights)
+        const int num_lights,
+        const uint64_t seed,
+        const Lamp_Placement placement)
     {
-        if (this->tree_img.channels() != 4)
+        // Непрозрачные пиксели ёлки собираются один раз на все группы
+        const Alpha_Sampler sampler(this->tree_img);
+        
+        std::mt19937 gen(seed);
+        
+        for (Group_Lamps &g : this->vec_groups_lamps)
         {
-            throw std::runtime_error(
-                "Ошибка: изображение должно быть в формате BGRA!\n");
+            g.lights = placement == Lamp_Placement::poisson_disk ?
+                sampler.sample_poisson_disk(num_lights, gen) :
+                sampler.sample_uniform(num_lights, gen);
         }
+    }
+    
+    void Light::build_timeline(const uint32_t total_frames)
+    {
+        this->vec_frames_switch.clear();
         
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> x_dist(0, this->tree_img.cols - 1);
-        std::uniform_int_distribution<int> y_dist(0, this->tree_img.rows - 1);
-                
-        for (Group_Lamps &g : this->vec_groups_lamps)
+        // Тот же счётчик, что раньше менялся внутри render:
+        // режим сменяется после кадра, кратного его длительности
+        uint32_t num_mode = 0u;
+        for (uint32_t frame_idx = 0u; frame_idx < total_frames; ++frame_idx)
         {
-            g.lights = std::vector<cv::Point2f>(num_lights);
+            const uint32_t idx_mode = num_mode % this->count_state_lamps;
+            const uint32_t limit_frames_mode =
+                this->vec_state_lamps[idx_mode].limit_frames;
             
-            uint32_t index_fill = 0u;
-            
-            for (;;)
+            if ((frame_idx + 1) % limit_frames_mode == 0)
             {
-                const int x = x_dist(gen);
-                const int y = y_dist(gen);
-                
-                // Получаем пиксель (B, G, R, A)
-                const cv::Vec4b &pixel =
-                    this->tree_img.at<cv::Vec4b>(y, x);
-                
-                // Проверяем альфа-канал: если > 0 — значит, не прозрачный (ёлка!)
-                if (pixel[3] > 0)
-                {
-                    cv::Point2f point(x, y);
-                    g.lights[index_fill] = std::move(point);
-                    ++index_fill;
-                }
-                
-                if (index_fill >= num_lights)
-                {
-                    break;
-                }
-                
+                this->vec_frames_switch.push_back(frame_idx);
+                ++num_mode;
             }
         }
         
+        this->total_frames_timeline = total_frames;
+        
+        // Режим растёт только на сменах, радиусов немного
+        this->vec_radii.clear();
+        for (uint32_t num_mode = 0u;
+             num_mode <= this->vec_frames_switch.size();
+             ++num_mode)
+        {
+            this->vec_radii.push_back(this->get_radius(num_mode));
+        }
+        
+        std::sort(this->vec_radii.begin(), this->vec_radii.end());
+        this->vec_radii.erase(
+            std::unique(this->vec_radii.begin(), this->vec_radii.end()),
+            this->vec_radii.end());
+        
+        this->idx_radius_maps = UINT32_MAX;
+        this->idx_radius_maps_yuv = UINT32_MAX;
+    }
+    
+    uint32_t Light::get_num_mode(const uint32_t frame_idx) const
+    {
+        if (frame_idx >= this->total_frames_timeline)
+        {
+            throw std::runtime_error(
+                "Ошибка: кадр вне расписания гирлянды, "
+                "нужен build_timeline\n");
+        }
+        
+        // Число смен режима на кадрах до frame_idx
+        return std::lower_bound(
+            this->vec_frames_switch.begin(),
+            this->vec_frames_switch.end(),
+            frame_idx) - this->vec_frames_switch.begin();
     }
     
     void Light::convert_tree_coords_to_frame_coords(
@@ -109,6 +155,13 @@ namespace InSomnia
     {
         static constexpr float scale = 1.f;
         
+        if (this->vec_radii.empty())
+        {
+            throw std::runtime_error(
+                "Ошибка: радиусы огоньков неизвестны, "
+                "нужен build_timeline\n");
+        }
+        
         for (Group_Lamps &g : this->vec_groups_lamps)
         {
             std::vector<cv::Point2f> &lights = g.lights;
@@ -134,6 +187,88 @@ namespace InSomnia
             
         }
         
+        // Ёлка в кадре: пиксель ёлки (x, y) — пиксель кадра
+        // (x + offset_x, y + offset_y)
+        const float offset_x = tree_pos_x - (this->tree_img.cols) / 2.f;
+        const float offset_y = tree_pos_y - (this->tree_img.rows) / 2.f;
+        
+        int x_min = this->tree_img.cols;
+        int y_min = this->tree_img.rows;
+        int x_max = -1;
+        int y_max = -1;
+        
+        for (int y = 0; y < this->tree_img.rows; ++y)
+        {
+            const cv::Vec4b *row = this->tree_img.ptr<cv::Vec4b>(y);
+            
+            for (int x = 0; x < this->tree_img.cols; ++x)
+            {
+                if (row[x][3] > 0)
+                {
+                    x_min = std::min(x_min, x);
+                    x_max = std::max(x_max, x);
+                    y_min = std::min(y_min, y);
+                    y_max = std::max(y_max, y);
+                }
+            }
+        }
+        
+        this->rect_maps = cv::Rect();
+        this->tree_alpha_maps = cv::Mat();
+        this->idx_radius_maps = UINT32_MAX;
+        this->idx_radius_maps_yuv = UINT32_MAX;
+        
+        if (x_max < 0)
+        {
+            return;
+        }
+        
+        // Огоньки стоят и на краю ёлки: круг самого большого
+        // радиуса расписания должен поместиться в карту целиком
+        const float radius_max = std::max(1u, this->vec_radii.back());
+        const int pad = static_cast<int>(std::ceil(radius_max + 0.5f));
+        
+        // Чётные границы: блоки цветности не делятся краем карты
+        const int x_begin = std::max(0,
+            static_cast<int>(std::floor(x_min - pad + offset_x)) & ~1);
+        const int y_begin = std::max(0,
+            static_cast<int>(std::floor(y_min - pad + offset_y)) & ~1);
+        const int x_end = std::min(this->width,
+            (static_cast<int>(std::ceil(x_max + 1 + pad + offset_x)) + 1) & ~1);
+        const int y_end = std::min(this->height,
+            (static_cast<int>(std::ceil(y_max + 1 + pad + offset_y)) + 1) & ~1);
+        
+        if (x_begin >= x_end || y_begin >= y_end)
+        {
+            return;
+        }
+        
+        this->rect_maps =
+            cv::Rect(x_begin, y_begin, x_end - x_begin, y_end - y_begin);
+        
+        this->tree_alpha_maps =
+            cv::Mat(this->rect_maps.height, this->rect_maps.width, CV_8UC1);
+        
+        for (int y = 0; y < this->rect_maps.height; ++y)
+        {
+            uint8_t *row = this->tree_alpha_maps.ptr<uint8_t>(y);
+            
+            const int tree_y = static_cast<int>(
+                std::lround(y + this->rect_maps.y - offset_y));
+            
+            for (int x = 0; x < this->rect_maps.width; ++x)
+            {
+                const int tree_x = static_cast<int>(
+                    std::lround(x + this->rect_maps.x - offset_x));
+                
+                const bool is_inside =
+                    tree_x >= 0 && tree_x < this->tree_img.cols &&
+                    tree_y >= 0 && tree_y < this->tree_img.rows;
+                
+                row[x] = is_inside ?
+                    this->tree_img.at<cv::Vec4b>(tree_y, tree_x)[3] : 0u;
+            }
+        }
     }
     
     // void Light::generate_light(
@@ -220,11 +355,24 @@ namespace InSomnia
     //     }
     // }
     
-    void Light::render(
+    uint32_t Light::get_radius(const uint32_t num_mode) const
+    {
+        return
+            // radius_base + 2. * num_mode / count_state_lamps;
+            this->radius_base *
+                (
+                    1. + 0.25 * num_mode /
+                    this->count_state_lamps
+                );
+    }
+    
+    const std::vector<bool>& Light::get_state_color(
         const uint32_t frame_idx,
-        cv::Mat &frame)
-    {        
-        const uint32_t idx_mode = this->num_mode % this->count_state_lamps;
+        uint32_t &idx_radius) const
+    {
+        const uint32_t num_mode = this->get_num_mode(frame_idx);
+        
+        const uint32_t idx_mode = num_mode % this->count_state_lamps;
         const State_Lamps &mode = this->vec_state_lamps[idx_mode];
         
         const std::vector<bool> &vec_state_color =
@@ -232,7 +380,6 @@ namespace InSomnia
         // const double duration = mode.duration;
         // const uint32_t limit_frames_mode =
         //     duration * fps;
-        const uint32_t limit_frames_mode = mode.limit_frames;
         
         if (vec_state_color.size() != this->count_colors)
         {
@@ -240,32 +387,208 @@ namespace InSomnia
                 "vec_state_color is incorrect");
         }
         
-        const uint32_t radius =
-            // radius_base + 2. * num_mode / count_state_lamps;
-            this->radius_base *
-                (
-                    1. + 0.25 * this->num_mode /
-                    this->count_state_lamps
-                );
+        const uint32_t radius = this->get_radius(num_mode);
+        
+        idx_radius = std::lower_bound(
+            this->vec_radii.begin(),
+            this->vec_radii.end(),
+            radius) - this->vec_radii.begin();
+        
+        return vec_state_color;
+    }
+    
+    void Light::accumulate_light(
+        const Group_Lamps &g,
+        const uint32_t radius,
+        cv::Mat &accum) const
+    {
+        // Огонёк: сглаженный круг прежнего радиуса с почти белой
+        // серединой и рассеянный свет до 2.5 радиусов, который
+        // виден только на ветках
+        static constexpr float scale_spill = 2.5f;
+        static constexpr float strength_spill = 0.6f;
+        static constexpr float strength_core = 0.8f;
+        
+        const float r = std::max(1u, radius);
+        const float radius_spill = r * scale_spill;
+        const int reach = static_cast<int>(std::ceil(radius_spill));
+        
+        accum.setTo(cv::Scalar(0, 0, 0));
         
-        for (uint32_t i = 0u; i < this->count_colors; ++i)
+        for (const cv::Point2f &pt : g.lights)
         {
-            const bool b = vec_state_color[i];
-            if (b)
+            // Центр огонька — центр его пикселя, как у cv::circle
+            const float cx = pt.x - this->rect_maps.x + 0.5f;
+            const float cy = pt.y - this->rect_maps.y + 0.5f;
+            
+            const int x_begin = std::max(0, static_cast<int>(cx) - reach);
+            const int y_begin = std::max(0, static_cast<int>(cy) - reach);
+            const int x_end = std::min(
+                accum.cols, static_cast<int>(cx) + reach + 1);
+            const int y_end = std::min(
+                accum.rows, static_cast<int>(cy) + reach + 1);
+            
+            for (int y = y_begin; y < y_end; ++y)
             {
-                const Group_Lamps &g = this->vec_groups_lamps[i];
-                const std::vector<cv::Point2f> &lights = g.lights;
-                const cv::Scalar &color = g.color;
-                for (const cv::Point2f &pt : lights)
-                { 
-                    cv::circle(frame, pt, radius, color, -1);
+                cv::Vec3f *row = accum.ptr<cv::Vec3f>(y);
+                const uint8_t *row_alpha =
+                    this->tree_alpha_maps.ptr<uint8_t>(y);
+                
+                for (int x = x_begin; x < x_end; ++x)
+                {
+                    const float d = std::hypot(x + 0.5f - cx, y + 0.5f - cy);
+                    if (d >= radius_spill)
+                    {
+                        continue;
+                    }
+                    
+                    const float core = std::clamp(r + 0.5f - d, 0.f, 1.f);
+                    
+                    const float t = 1.f - d / radius_spill;
+                    const float spill =
+                        strength_spill * t * t * (row_alpha[x] / 255.f);
+                    
+                    // Середина огонька светлее, к краю — чистый цвет
+                    const float c = std::max(0.f, 1.f - d / (0.5f * r));
+                    const float white = strength_core * c * c;
+                    
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const float color = g.color[k];
+                        row[x][k] +=
+                            (color * (1.f - white) + 255.f * white) * core +
+                            color * spill;
+                    }
+                }
+            }
+        }
+    }
+    
+    void Light::build_light_maps(const uint32_t idx_radius)
+    {
+        cv::Mat accum(
+            this->rect_maps.height, this->rect_maps.width, CV_32FC3);
+        
+        for (Group_Lamps &g : this->vec_groups_lamps)
+        {
+            this->accumulate_light(g, this->vec_radii[idx_radius], accum);
+            
+            g.light_map =
+                cv::Mat(this->rect_maps.height, this->rect_maps.width, CV_8UC3);
+            
+            for (int y = 0; y < accum.rows; ++y)
+            {
+                const cv::Vec3f *src = accum.ptr<cv::Vec3f>(y);
+                cv::Vec3b *dst = g.light_map.ptr<cv::Vec3b>(y);
+                
+                for (int x = 0; x < accum.cols; ++x)
+                {
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        dst[x][k] = cv::saturate_cast<uchar>(src[x][k]);
+                    }
+                }
+            }
+        }
+        
+        this->idx_radius_maps = idx_radius;
+    }
+    
+    void Light::build_light_maps_yuv(const uint32_t idx_radius)
+    {
+        const int width_maps = this->rect_maps.width;
+        const int height_maps = this->rect_maps.height;
+        
+        cv::Mat accum(height_maps, width_maps, CV_32FC3);
+        
+        for (Group_Lamps &g : this->vec_groups_lamps)
+        {
+            this->accumulate_light(g, this->vec_radii[idx_radius], accum);
+            
+            g.light_map_y = cv::Mat(height_maps, width_maps, CV_8UC1);
+            g.light_map_u = cv::Mat(height_maps / 2, width_maps / 2, CV_8SC1);
+            g.light_map_v = cv::Mat(height_maps / 2, width_maps / 2, CV_8SC1);
+            
+            // Прибавка света в YUV — линейная часть перевода из BGR,
+            // без смещений 16 и 128
+            for (int y = 0; y < height_maps; ++y)
+            {
+                const cv::Vec3f *src = accum.ptr<cv::Vec3f>(y);
+                uint8_t *dst = g.light_map_y.ptr<uint8_t>(y);
+                
+                for (int x = 0; x < width_maps; ++x)
+                {
+                    const cv::Vec3f yuv = bgr_to_yuv_premultiplied(
+                        src[x][0], src[x][1], src[x][2], 0.f);
+                    dst[x] = cv::saturate_cast<uchar>(yuv[0]);
                 }
             }
+            
+            for (int y = 0; y < height_maps / 2; ++y)
+            {
+                const cv::Vec3f *src_0 = accum.ptr<cv::Vec3f>(2 * y);
+                const cv::Vec3f *src_1 = accum.ptr<cv::Vec3f>(2 * y + 1);
+                int8_t *dst_u = g.light_map_u.ptr<int8_t>(y);
+                int8_t *dst_v = g.light_map_v.ptr<int8_t>(y);
+                
+                for (int x = 0; x < width_maps / 2; ++x)
+                {
+                    const cv::Vec3f sum =
+                        src_0[2 * x] + src_0[2 * x + 1] +
+                        src_1[2 * x] + src_1[2 * x + 1];
+                    const cv::Vec3f yuv = bgr_to_yuv_premultiplied(
+                        0.25f * sum[0], 0.25f * sum[1], 0.25f * sum[2], 0.f);
+                    
+                    dst_u[x] = static_cast<int8_t>(
+                        std::clamp(std::lround(yuv[1]), -128L, 127L));
+                    dst_v[x] = static_cast<int8_t>(
+                        std::clamp(std::lround(yuv[2]), -128L, 127L));
+                }
+            }
+        }
+        
+        this->idx_radius_maps_yuv = idx_radius;
+    }
+    
+    void Light::render(
+        const uint32_t frame_idx,
+        cv::Mat &frame)
+    {
+        uint32_t idx_radius = 0u;
+        const std::vector<bool> &vec_state_color =
+            this->get_state_color(frame_idx, idx_radius);
+        
+        if (this->rect_maps.empty())
+        {
+            return;
         }
         
-        if ((frame_idx + 1) % limit_frames_mode == 0)
+        if (this->idx_radius_maps != idx_radius)
         {
-            ++(this->num_mode);
+            this->build_light_maps(idx_radius);
+        }
+        
+        const int count = 3 * this->rect_maps.width;
+        
+        // Строка кадра остаётся в кеше, пока к ней прибавляются
+        // все включённые группы
+        for (int y = 0; y < this->rect_maps.height; ++y)
+        {
+            uint8_t *dst =
+                frame.ptr<uint8_t>(this->rect_maps.y + y) +
+                3 * this->rect_maps.x;
+            
+            for (uint32_t i = 0u; i < this->count_colors; ++i)
+            {
+                const bool b = vec_state_color[i];
+                if (b)
+                {
+                    add_plane_saturate(
+                        this->vec_groups_lamps[i].light_map.ptr<uint8_t>(y),
+                        dst,
+                        count);
+                }
+            }
         }
         
         // if ((frame_idx + 1) % fps == 0)
@@ -277,4 +600,63 @@ namespace InSomnia
         // }
     }
     
+    void Light::render(
+        const uint32_t frame_idx,
+        Frame_Yuv420 &frame)
+    {
+        uint32_t idx_radius = 0u;
+        const std::vector<bool> &vec_state_color =
+            this->get_state_color(frame_idx, idx_radius);
+        
+        if (this->rect_maps.empty())
+        {
+            return;
+        }
+        
+        if (this->idx_radius_maps_yuv != idx_radius)
+        {
+            this->build_light_maps_yuv(idx_radius);
+        }
+        
+        const cv::Rect &rect = this->rect_maps;
+        
+        for (int y = 0; y < rect.height; ++y)
+        {
+            uint8_t *dst = frame.get_y().ptr<uint8_t>(rect.y + y) + rect.x;
+            
+            for (uint32_t i = 0u; i < this->count_colors; ++i)
+            {
+                if (vec_state_color[i])
+                {
+                    add_plane_saturate(
+                        this->vec_groups_lamps[i].light_map_y.ptr<uint8_t>(y),
+                        dst,
+                        rect.width);
+                }
+            }
+        }
+        
+        for (int y = 0; y < rect.height / 2; ++y)
+        {
+            uint8_t *dst_u =
+                frame.get_u().ptr<uint8_t>(rect.y / 2 + y) + rect.x / 2;
+            uint8_t *dst_v =
+                frame.get_v().ptr<uint8_t>(rect.y / 2 + y) + rect.x / 2;
+            
+            for (uint32_t i = 0u; i < this->count_colors; ++i)
+            {
+                if (!vec_state_color[i])
+                {
+                    continue;
+                }
+                
+                const Group_Lamps &g = this->vec_groups_lamps[i];
+                add_plane_signed(
+                    g.light_map_u.ptr<int8_t>(y), dst_u, rect.width / 2);
+                add_plane_signed(
+                    g.light_map_v.ptr<int8_t>(y), dst_v, rect.width / 2);
+            }
+        }
+    }
+    
 }
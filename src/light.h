@@ -2,18 +2,37 @@
 #define INSOMNIA_LIGHT_H
 
 // #include <iostream>
+#include <algorithm>
 #include <vector>
 #include <random>
 #include <limits>
 
 #include <opencv2/opencv.hpp>
 
+#include "frame_yuv420.h"
+#include "alpha_sampler.h"
+
 namespace InSomnia
 {
     struct Group_Lamps
     {
         cv::Scalar color;
         std::vector<cv::Point2f> lights;
+        
+        // Свет всех огоньков группы в прямоугольнике ёлки,
+        // прибавляется к кадру. BGR или Y в полном разрешении,
+        // сдвиги U и V со знаком — в половинном
+        cv::Mat light_map;
+        cv::Mat light_map_y;
+        cv::Mat light_map_u;
+        cv::Mat light_map_v;
+    };
+    
+    // Как раскладывать огоньки по ёлке
+    enum class Lamp_Placement
+    {
+        uniform,      // независимо и равномерно
+        poisson_disk  // синий шум: без скоплений и пустот
     };
     
     struct State_Lamps
@@ -38,9 +57,22 @@ namespace InSomnia
             const int fps,
             const double scale);
         
+        // seed задаёт одинаковое расположение огоньков при каждом запуске
         void generate_lights_inside_tree_by_alpha(
-            const int num_lights);
+            const int num_lights,
+            const uint64_t seed);
         
+        void generate_lights_inside_tree_by_alpha(
+            const int num_lights,
+            const uint64_t seed,
+            const Lamp_Placement placement);
+        
+        // Кадры смены режимов гирлянды на всё видео:
+        // номер режима для любого кадра без прохода по предыдущим
+        void build_timeline(const uint32_t total_frames);
+        
+        // После build_timeline: карты света с запасом
+        // на самый большой радиус огонька
         void convert_tree_coords_to_frame_coords(
             const float tree_pos_x,
             const float tree_pos_y);
@@ -50,20 +82,68 @@ namespace InSomnia
         //     const std::vector<State_Lamps> &vec_state_lamps,
         //     std::vector<cv::Mat> &vec_frames);
         
+        // Кадры можно рисовать в любом порядке после build_timeline.
+        // Режим лишь включает группы цветов, огоньки неподвижны,
+        // поэтому кадр — сумма готовых карт включённых групп за один
+        // проход по прямоугольнику ёлки, сколько бы ни было огоньков.
+        // Карты пересчитываются, только когда меняется радиус
         void render(
             const uint32_t frame_idx,
             cv::Mat &frame);
         
+        // Те же карты в YUV 4:2:0
+        void render(
+            const uint32_t frame_idx,
+            Frame_Yuv420 &frame);
+        
     private:
+        uint32_t get_num_mode(const uint32_t frame_idx) const;
+        
+        uint32_t get_radius(const uint32_t num_mode) const;
+        
+        // Включённые цвета режима и номер радиуса огонька в vec_radii
+        const std::vector<bool>& get_state_color(
+            const uint32_t frame_idx,
+            uint32_t &idx_radius) const;
+        
+        // Свет группы в float BGR размером rect_maps
+        void accumulate_light(
+            const Group_Lamps &g,
+            const uint32_t radius,
+            cv::Mat &accum) const;
+        
+        void build_light_maps(const uint32_t idx_radius);
+        
+        void build_light_maps_yuv(const uint32_t idx_radius);
+        
         cv::Mat tree_img;
         std::vector<Group_Lamps> vec_groups_lamps;
         std::vector<InSomnia::State_Lamps> vec_state_lamps;
         
         uint32_t count_colors;
         uint32_t count_state_lamps;
+        int width;
+        int height;
         double diagonal;
         double radius_base;
-        uint32_t num_mode;
+        
+        // Кадры, после которых номер режима растёт на единицу
+        std::vector<uint32_t> vec_frames_switch;
+        uint32_t total_frames_timeline;
+        
+        // Радиусы огоньков во всех режимах расписания по возрастанию
+        std::vector<uint32_t> vec_radii;
+        
+        // Ограничивающий прямоугольник ёлки в кадре, расширенный
+        // на радиус огонька, с чётными границами (для цветности
+        // 4:2:0) и альфа ёлки в нём:
+        // рассеянный свет ложится только на ветки
+        cv::Rect rect_maps;
+        cv::Mat tree_alpha_maps;
+        
+        // Для какого радиуса построены карты, UINT32_MAX — ни для какого
+        uint32_t idx_radius_maps;
+        uint32_t idx_radius_maps_yuv;
     };
 }
 
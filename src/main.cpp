@@ -1,213 +1,562 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <charconv>
+#include <filesystem>
 #include <format>
+#include <memory>
+#include <optional>
+#include <thread>
 
-#include "snowflake.h"
-#include "fir.h"
-#include "light.h"
-#include "hare.h"
-#include "snow_cover.h"
+#include "scene.h"
+#include "segmented_render.h"
+#include "frame_sink.h"
+#include "frame_yuv420.h"
+#include "y4m_sink.h"
+#include "image_sequence_sink.h"
 #include "toolbox.h"
 
 // Добавить блеск снежинок
 
-int main()
+// Выход по имени: video, null, y4m, png или qoi.
+// count_frames_keep — сколько кадров Y4M оставить при продолжении
+static std::unique_ptr<InSomnia::Frame_Sink> make_sink(
+    const std::string &name_sink,
+    const std::string &path_output,
+    const int width,
+    const int height,
+    const int fps,
+    const uint32_t count_frames_keep)
 {
-    // Config
+    if (name_sink == "video")
+    {
+        return std::make_unique<InSomnia::Video_Writer_Sink>(
+            path_output, width, height, fps);
+    }
     
-    // 3840 x 2160
-    // 1920 x 1080
-    static constexpr int width = 3840;
-    static constexpr int height = 2160;
-    static constexpr int fps = 60;
-    static constexpr double duration_sec = 200.0;
-    static const int total_frames =
-        static_cast<int>(duration_sec * fps);
-    static const int type = CV_8UC3;
-    static const std::string dir_img =
-        "../../img";
+    if (name_sink == "null")
+    {
+        return std::make_unique<InSomnia::Null_Sink>();
+    }
     
-    // Prepare
+    if (name_sink == "y4m")
+    {
+        return std::make_unique<InSomnia::Y4m_Sink>(
+            path_output, width, height, fps, count_frames_keep);
+    }
     
-    // Snow
+    if (name_sink == "png" || name_sink == "qoi")
+    {
+        const uint32_t count_threads =
+            std::max(1u, std::thread::hardware_concurrency());
+        
+        return std::make_unique<InSomnia::Image_Sequence_Sink>(
+            path_output,
+            name_sink == "png" ?
+                InSomnia::Image_Format::png : InSomnia::Image_Format::qoi,
+            count_threads,
+            2u * count_threads);
+    }
     
-    static const std::string path_file_snowflake =
-        dir_img + "/snow.png";
+    throw std::runtime_error(
+        "Ошибка: неизвестный выход " + name_sink + "\n");
+}
+
+static std::string get_default_output(const std::string &name_sink)
+{
+    if (name_sink == "y4m")
+    {
+        return "result.y4m";
+    }
     
-    std::vector<InSomnia::Interval_Snow> schedule_snowfall =
+    if (name_sink == "png" || name_sink == "qoi")
     {
-        { 0., 30., 200, 0, 0 }
-        // { 30., 50., 500, 0, 0 }
-    };
+        return "frames";
+    }
     
-    InSomnia::Snowfall snowfall(
-        path_file_snowflake,
-        schedule_snowfall,
-        fps,
-        total_frames);
+    return "result.mp4";
+}
+
+// Видео нельзя дописать: после контрольной точки кадры идут
+// в новую часть result.from000600.mp4 рядом с частью сегмента.
+// С контрольными точками имя по первому кадру и у первой части,
+// иначе склейка ffmpeg перезаписала бы один из своих входов
+static std::string get_part_path(
+    const InSomnia::Segment &segment,
+    const uint32_t frame_first,
+    const bool is_resumable)
+{
+    if (!is_resumable)
+    {
+        return segment.path_file;
+    }
     
-    // Fir
+    const std::filesystem::path path(segment.path_file);
+    std::filesystem::path path_part = path;
+    path_part.replace_filename(std::format(
+        "{}.from{:06}{}",
+        path.stem().string(), frame_first, path.extension().string()));
     
-    static const std::string path_file_fir =
-        dir_img + "/tree.png";
+    return path_part.string();
+}
+
+// Один и тот же файл под разными путями: относительный путь,
+// символическая или жёсткая ссылка
+static bool is_same_file(
+    const std::string &path_a,
+    const std::string &path_b)
+{
+    if (std::filesystem::weakly_canonical(path_a) ==
+        std::filesystem::weakly_canonical(path_b))
+    {
+        return true;
+    }
     
-    static constexpr float coord_fir_x = width * 0.5;
-    static constexpr float coord_fir_y = height * 0.5;
+    std::error_code error;
+    return std::filesystem::equivalent(path_a, path_b, error);
+}
+
+// Сборка кусков, отрендеренных отдельно (--start-frame/--end-frame):
+// Y4M склеивается без потерь, для видео пишется список ffmpeg concat.
+// Последовательности картинок собирать не нужно — имена файлов
+// уже по номеру кадра
+static int merge_chunks(
+    const std::string &name_sink,
+    const std::vector<std::string> &paths_chunks,
+    const std::string &path_output)
+{
+    if (paths_chunks.empty())
+    {
+        std::cerr << "Ошибка: --merge без кусков\n";
+        return 1;
+    }
     
-    static constexpr float scale_fir = 0.8;
+    if (path_output == "-")
+    {
+        std::cerr << "Ошибка: --merge нельзя писать в stdout\n";
+        return 1;
+    }
     
-    InSomnia::Fir fir(
-        path_file_fir, width, height, scale_fir);
+    // Выход открывается на запись до чтения кусков, а склейка
+    // ffmpeg перезаписала бы свой же вход: совпадение — ошибка
+    for (const std::string &path_chunk : paths_chunks)
+    {
+        if (is_same_file(path_chunk, path_output))
+        {
+            std::cerr << "Ошибка: кусок " << path_chunk
+                      << " совпадает с выходом " << path_output
+                      << ", укажите другой --output\n";
+            return 1;
+        }
+    }
     
-    // Light
+    if (name_sink == "y4m")
+    {
+        InSomnia::join_y4m_parts(paths_chunks, path_output, false);
+        
+        std::cout << "Куски собраны в " << path_output << "\n";
+        return 0;
+    }
     
-    const cv::Mat &img_fir = fir.get_img();
+    if (name_sink == "video")
+    {
+        const std::filesystem::path path(path_output);
+        std::filesystem::path path_manifest = path;
+        path_manifest.replace_filename(path.stem().string() + ".parts.txt");
+        
+        InSomnia::write_concat_manifest(path_manifest.string(), paths_chunks);
+        
+        std::cout << std::format(
+            "Список кусков записан в {}, склеить: "
+            "ffmpeg -f concat -safe 0 -i {} -c copy {}\n",
+            path_manifest.string(), path_manifest.string(), path_output);
+        return 0;
+    }
+    
+    std::cerr << "Ошибка: --merge только для y4m и video\n";
+    return 1;
+}
+
+static void print_usage(const char *name_program)
+{
+    std::cerr << "Использование: " << name_program
+              << " [--sink video|null|y4m|png|qoi]"
+              << " [--output <путь>]"
+              << " [--format bgr|yuv420]"
+              << " [--segments <K>]"
+              << " [--start-frame <S>] [--end-frame <E>]"
+              << " [--checkpoint-interval <N>] [--resume]"
+              << " [--merge <куски...>]\n";
+}
+
+// Число из аргумента: только десятичные цифры, не больше UINT32_MAX.
+// Знак минус и переполнение — ошибка, а не тихий перенос
+static std::optional<uint32_t> parse_uint32(const std::string &text)
+{
+    uint32_t value = 0u;
+    const char *end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, value);
     
-    const std::vector<cv::Scalar> colors_lamps =
+    if (text.empty() || ec != std::errc() || ptr != end)
     {
-        { 0, 0, 255 },   // blue
-        { 0, 255, 0 },   // green
-        { 255, 0, 0 },   // red
-        { 0, 255, 255 }  // yellow
-    };
+        return std::nullopt;
+    }
     
-    const std::vector<InSomnia::State_Lamps> vec_state_lamps =
+    return value;
+}
+
+int main(int argc, char **argv)
+{
+    // Аргументы: --sink video|null|y4m|png|qoi, --output <путь>,
+    // для y4m путь "-" — стандартный вывод.
+    // --format bgr|yuv420: yuv420 рисует сразу в плоскости I420,
+    // по умолчанию для y4m.
+    // --segments K: K частей рендерятся и кодируются параллельно.
+    // --start-frame S --end-frame E: только кадры [S, E) — кусок
+    // для одной машины. --merge <куски...>: собрать куски по порядку.
+    // --checkpoint-interval N: контрольная точка каждые N кадров
+    // сегмента, --resume: продолжить с последних точек
+    std::string name_sink = "video";
+    std::string path_output;
+    std::string name_format;
+    uint32_t count_segments = 1u;
+    std::optional<uint32_t> start_frame;
+    std::optional<uint32_t> end_frame;
+    uint32_t checkpoint_interval = 0u;
+    bool is_resume = false;
+    bool is_merge = false;
+    std::vector<std::string> paths_chunks;
+    
+    for (int i = 1; i < argc; ++i)
     {
-        { { false, false, false, true }, 1., 0u },
-        { { false, false, true, false }, 1., 0u },
-        { { false, true, false, false }, 1., 0u },
-        { { true, false, false, false }, 1., 0u },
+        const std::string arg = argv[i];
         
-        { { false, false, true, true }, 1., 0u },
-        { { false, true, true, false }, 1., 0u },
-        { { true, true, false, false }, 1., 0u },
-        { { true, false, false, true }, 1., 0u },
-        
-        { { false, true, true, true }, 0.5, 0u },
-        { { true, true, true, false }, 0.5, 0u },
-        { { true, true, false, true }, 0.5, 0u },
-        { { true, false, true, true }, 0.5, 0u }
-    };
+        if (arg == "--sink" && i + 1 < argc)
+        {
+            name_sink = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            path_output = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            name_format = argv[++i];
+        }
+        else if (arg == "--segments" && i + 1 < argc)
+        {
+            const std::optional<uint32_t> value = parse_uint32(argv[++i]);
+            
+            if (!value || *value == 0u)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            
+            count_segments = *value;
+        }
+        else if (arg == "--start-frame" && i + 1 < argc)
+        {
+            start_frame = parse_uint32(argv[++i]);
+            
+            if (!start_frame)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--end-frame" && i + 1 < argc)
+        {
+            end_frame = parse_uint32(argv[++i]);
+            
+            if (!end_frame)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--checkpoint-interval" && i + 1 < argc)
+        {
+            // 0 — без контрольных точек, как по умолчанию
+            const std::optional<uint32_t> value = parse_uint32(argv[++i]);
+            
+            if (!value)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            
+            checkpoint_interval = *value;
+        }
+        else if (arg == "--resume")
+        {
+            is_resume = true;
+        }
+        else if (arg == "--merge")
+        {
+            is_merge = true;
+            paths_chunks.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
     
-    static constexpr double scale = 0.003;
+    if (path_output.empty())
+    {
+        path_output = get_default_output(name_sink);
+    }
     
-    InSomnia::Light light(
-        img_fir,
-        colors_lamps,
-        vec_state_lamps,
-        width,
-        height,
-        fps,
-        scale);
+    if (is_merge)
+    {
+        return merge_chunks(name_sink, paths_chunks, path_output);
+    }
     
-    const uint32_t count_lamps = 50u;
-    light.generate_lights_inside_tree_by_alpha(count_lamps);
+    if (name_format.empty())
+    {
+        name_format = name_sink == "y4m" ? "yuv420" : "bgr";
+    }
     
-    light.convert_tree_coords_to_frame_coords(
-        coord_fir_x, coord_fir_y);
+    if (name_format != "bgr" && name_format != "yuv420")
+    {
+        std::cerr << "Ошибка: неизвестный формат " << name_format << "\n";
+        return 1;
+    }
     
-    // Hare
+    // Кадр YUV принимают только приёмники без перевода в BGR
+    const InSomnia::Frame_Format format = name_format == "yuv420" ?
+        InSomnia::Frame_Format::yuv420 : InSomnia::Frame_Format::bgr;
     
-    const std::string path_file_hare =
-        dir_img + "/hare.png";
+    if (format == InSomnia::Frame_Format::yuv420 &&
+        name_sink != "y4m" && name_sink != "null")
+    {
+        std::cerr << "Ошибка: формат yuv420 только для y4m и null\n";
+        return 1;
+    }
     
-    const float scale_hare = 0.2;
+    if (count_segments > 1u && path_output == "-")
+    {
+        std::cerr << "Ошибка: сегменты нельзя писать в stdout\n";
+        return 1;
+    }
+    
+    const bool is_resumable = checkpoint_interval > 0u || is_resume;
     
-    // Физические параметры (в пикселях и кадрах)
-    const double g_pixels_per_sec_sq = 9.8 * height * 0.08; // Ускорение "гравитации"
-    const double vx_per_jump = width * 0.14; // Скорость вперёд за прыжок (пикс/сек)
-    const double vy_initial = - height * 0.42; // Начальная скорость вверх (пикс/сек)
-    const double ground_y = height * 0.8; // Уровень "земли"
+    if (is_resumable && path_output == "-")
+    {
+        std::cerr << "Ошибка: вывод в stdout нельзя продолжить\n";
+        return 1;
+    }
     
-    const double start_x = width * 0.2;
-    const double jump_interval = 0.8;
+    // Видео в стандартный вывод: сообщения только в stderr
+    std::ostream &log =
+        path_output == "-" ? std::cerr : std::cout;
     
-    InSomnia::Hare hare(
-        path_file_hare,
+    // Config
+    
+    // 3840 x 2160
+    // 1920 x 1080
+    static constexpr int width = 3840;
+    static constexpr int height = 2160;
+    static constexpr int fps = 60;
+    static constexpr double duration_sec = 200.0;
+    static const int total_frames =
+        static_cast<int>(duration_sec * fps);
+    static const std::string dir_img =
+        "../../img";
+    
+    // Один seed на всю сцену: каждый кадр можно посчитать
+    // заново и получить тот же результат
+    static constexpr uint64_t seed = 20251231u;
+    
+    const InSomnia::Scene_Config config =
+    {
         width,
         height,
-        scale_hare,
-        g_pixels_per_sec_sq,
-        vx_per_jump,
-        vy_initial,
-        ground_y,
-        start_x,
-        jump_interval);
+        fps,
+        static_cast<uint32_t>(total_frames),
+        dir_img,
+        seed,
+        format
+    };
     
-    // Snow cover
+    // Каждый поток рендерит свои кадры в своей сцене,
+    // буфер переупорядочивания держит не больше двух кадров на поток
+    const uint32_t count_workers =
+        std::max(1u, std::thread::hardware_concurrency());
     
-    InSomnia::Snow_Cover snow_cover;
+    // Кодирование в своём потоке, рендер ждёт только
+    // при полной очереди
+    static constexpr uint32_t capacity_encoder = 8u;
     
-    // Video
+    static constexpr bool use_huge_pages = true;
     
-    static const std::string path_file_video =
-        "result.mp4";
+    // Кусок [start_frame, end_frame): сцены перематываются
+    // к его началу и рисуют те же кадры, что и полный проход
+    const uint32_t frame_begin = start_frame.value_or(0u);
+    const uint32_t frame_end = end_frame.value_or(config.total_frames);
     
-    cv::VideoWriter video_writer(
-        path_file_video,
-        cv::VideoWriter::fourcc('m', 'p', '4', 'v'), 
-        fps,
-        cv::Size(width, height));
+    if (frame_begin >= frame_end || frame_end > config.total_frames)
+    {
+        std::cerr << std::format(
+            "Ошибка: диапазон кадров [{}, {}) вне [0, {})\n",
+            frame_begin, frame_end, config.total_frames);
+        return 1;
+    }
+    
+    const uint32_t count_frames = frame_end - frame_begin;
     
-    if (!video_writer.isOpened())
+    // В каждом сегменте хотя бы один кадр
+    if (count_segments > count_frames)
     {
-        throw std::runtime_error(
-            "Ошибка: не удалось открыть VideoWriter\n");
+        std::cerr << std::format(
+            "Ошибка: сегментов {} больше, чем кадров {}\n",
+            count_segments, count_frames);
+        print_usage(argv[0]);
+        return 1;
     }
     
-    for (uint32_t frame_idx = 0u;
-         frame_idx < total_frames;
-         ++frame_idx)
+    // Сегменты: каждый со своим кодировщиком и файлом-частью
+    const std::vector<InSomnia::Segment> segments =
+        InSomnia::split_segments(
+            frame_begin, frame_end, count_segments, path_output);
+    
+    InSomnia::Segmented_Render segmented_render(
+        config,
+        segments,
+        count_workers,
+        capacity_encoder,
+        use_huge_pages,
+        checkpoint_interval,
+        is_resume);
+    
+    // Output
+    
+    // Картинки всех сегментов в одном каталоге, Y4M дописывается
+    // в файл сегмента, видео после точки — в новую часть
+    segmented_render.run(
+        [&name_sink, &path_output, is_resumable](
+            const InSomnia::Segment &segment,
+            const uint32_t frame_first)
+        {
+            if (name_sink == "png" || name_sink == "qoi")
+            {
+                return make_sink(
+                    name_sink, path_output, width, height, fps, 0u);
+            }
+            
+            if (name_sink == "y4m")
+            {
+                return make_sink(
+                    name_sink, segment.path_file, width, height, fps,
+                    frame_first - segment.frame_begin);
+            }
+            
+            return make_sink(
+                name_sink,
+                get_part_path(segment, frame_first, is_resumable),
+                width, height, fps, 0u);
+        },
+        [&log, count_frames](const uint32_t count_done)
+        {
+            if (count_done % fps == 0)
+            {
+                const float ratio =
+                    static_cast<float>(count_done) / count_frames;
+                
+                log << std::format(
+                    "Записано кадров: {} из {} ({:.2f} %)\n",
+                    count_done, count_frames, 100.f * ratio);
+                log.flush();
+            }
+        });
+    
+    // Рендер ждал кодировщик — узкое место в кодировании,
+    // кодировщик ждал рендер — в рендере
+    for (const InSomnia::Segment &segment : segments)
     {
-        cv::Mat frame =
-            cv::Mat::zeros(height, width, type);
-        
-        
-        snow_cover.render(
-            frame_idx,
-            total_frames,
-            frame);
-        
-        snowfall.render(
-            frame_idx,
-            width,
-            height,
-            frame);
-        
-        fir.render(
-            frame_idx,
-            coord_fir_x,
-            coord_fir_y,
-            frame);
-        
-        light.render(
-            frame_idx,
-            frame);
-        
-        hare.render(
-            frame_idx,
-            fps,
-            frame);
+        const InSomnia::Frame_Queue_Stats &stats =
+            segmented_render.get_queue_stats()[segment.idx];
         
-        
-        video_writer.write(frame);
-        
-        if ((frame_idx + 1) % fps == 0)
+        log << std::format(
+            "Сегмент {} [{}, {}):\n"
+            "Очередь кодировщика: в среднем {:.2f} из {}, максимум {}\n"
+            "Рендер ждал кодировщик: {} раз, {:.2f} с\n"
+            "Кодировщик ждал рендер: {} раз, {:.2f} с\n",
+            segment.idx, segment.frame_begin, segment.frame_end,
+            stats.mean_occupancy, stats.capacity, stats.max_occupancy,
+            stats.count_push_waits, stats.seconds_push_wait,
+            stats.count_pop_waits, stats.seconds_pop_wait);
+    }
+    
+    // Скорость записи выхода без рендера: сравнить с --sink null
+    const InSomnia::Sink_Stats stats_sink =
+        segmented_render.get_sink_stats();
+    
+    log << std::format(
+        "Выход {}: {} кадров, {:.1f} МБ, запись {:.2f} с ({:.1f} кадр/с)\n",
+        name_sink, stats_sink.count_frames,
+        stats_sink.bytes_written / (1024.0 * 1024.0),
+        stats_sink.seconds,
+        stats_sink.seconds > 0.0 ?
+            stats_sink.count_frames / stats_sink.seconds : 0.0);
+    
+    // Части: Y4M склеивается здесь же без потерь, видео —
+    // списком для ffmpeg -f concat -c copy. Последовательность
+    // картинок уже общая: имена файлов по номеру кадра
+    if (count_segments > 1u && name_sink == "y4m")
+    {
+        InSomnia::join_y4m_parts(
+            InSomnia::get_segment_paths(segments), path_output, true);
+    }
+    
+    // Части видео: по сегментам и по контрольным точкам в них
+    std::vector<std::string> paths_parts;
+    for (const InSomnia::Segment &segment : segments)
+    {
+        for (const uint32_t frame_first :
+             segmented_render.get_sink_starts()[segment.idx])
         {
-            const float ratio =
-                static_cast<float>(frame_idx + 1) / total_frames;
-            
-            std::cout << std::format(
-                "Записано кадров: {} из {} ({:.2f} %)\n",
-                frame_idx + 1, total_frames, 100.f * ratio);
-            std::cout.flush();
+            paths_parts.push_back(
+                get_part_path(segment, frame_first, is_resumable));
         }
     }
     
-    video_writer.release();
+    // Всё записано: продолжать больше нечего
+    if (is_resumable)
+    {
+        segmented_render.remove_checkpoints();
+    }
+    
+    // Единственная часть и есть результат
+    if (paths_parts.size() == 1u &&
+        name_sink == "video" &&
+        paths_parts[0] != path_output)
+    {
+        std::filesystem::rename(paths_parts[0], path_output);
+    }
     
-    std::cout << "Видео сохранено как " << path_file_video << "\n";
-    std::cout.flush();
+    if (paths_parts.size() > 1u && name_sink == "video")
+    {
+        const std::filesystem::path path(path_output);
+        std::filesystem::path path_manifest = path;
+        path_manifest.replace_filename(
+            path.stem().string() + ".parts.txt");
+        
+        InSomnia::write_concat_manifest(path_manifest.string(), paths_parts);
+        
+        log << std::format(
+            "Части записаны в {}, склеить: "
+            "ffmpeg -f concat -safe 0 -i {} -c copy {}\n",
+            path_manifest.string(), path_manifest.string(), path_output);
+    }
+    else
+    {
+        log << "Результат сохранён как " << path_output << "\n";
+    }
+    log.flush();
     
     return 0;
 }
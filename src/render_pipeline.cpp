@@ -0,0 +1,207 @@
+#include "render_pipeline.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace InSomnia
+{
+    Render_Pipeline::Render_Pipeline()
+    {
+        this->count_workers = 0u;
+        this->max_depth = 0u;
+        this->frame_pool = nullptr;
+    }
+    
+    Render_Pipeline::Render_Pipeline(
+        const Scene_Config &config,
+        const uint32_t count_workers,
+        const uint32_t max_depth,
+        Frame_Pool &frame_pool)
+    {
+        if (count_workers == 0u || max_depth == 0u)
+        {
+            throw std::runtime_error(
+                "Ошибка: Render_Pipeline нужен хотя бы один поток "
+                "и один кадр в буфере\n");
+        }
+        
+        this->config = config;
+        this->count_workers = count_workers;
+        this->max_depth = max_depth;
+        this->frame_pool = &frame_pool;
+    }
+    
+    void Render_Pipeline::run(const Frame_Write_Function &write)
+    {
+        this->run(0u, this->config.total_frames, write);
+    }
+    
+    void Render_Pipeline::set_initial_state(
+        const std::vector<uint8_t> &state_scene)
+    {
+        this->state_initial = state_scene;
+    }
+    
+    void Render_Pipeline::run(
+        const uint32_t frame_begin,
+        const uint32_t frame_end,
+        const Frame_Write_Function &write)
+    {
+        if (frame_begin > frame_end ||
+            frame_end > this->config.total_frames)
+        {
+            throw std::runtime_error(
+                "Ошибка: неверный диапазон кадров для Render_Pipeline\n");
+        }
+        
+        std::atomic<uint32_t> next_render(frame_begin);
+        
+        std::mutex mutex;
+        std::condition_variable cv_ready; // Появился кадр в буфере
+        std::condition_variable cv_space; // Записан очередной кадр
+        
+        std::map<uint32_t, cv::Mat> reorder_buffer;
+        uint32_t next_write = frame_begin;
+        bool is_aborted = false;
+        std::exception_ptr error;
+        
+        auto worker = [&]()
+        {
+            try
+            {
+                Scene scene(this->config);
+                
+                if (!(this->state_initial.empty()))
+                {
+                    Binary_Reader reader(
+                        this->state_initial.data(),
+                        this->state_initial.size());
+                    scene.load_state(reader);
+                }
+                
+                for (;;)
+                {
+                    const uint32_t frame_idx = next_render.fetch_add(1u);
+                    if (frame_idx >= frame_end)
+                    {
+                        break;
+                    }
+                    
+                    // Кадр next_write никогда не ждёт,
+                    // поэтому очередь всегда продвигается
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv_space.wait(lock, [&]()
+                        {
+                            return
+                                is_aborted ||
+                                frame_idx < next_write + this->max_depth;
+                        });
+                        
+                        if (is_aborted)
+                        {
+                            break;
+                        }
+                    }
+                    
+                    // Кадр начинается с копии фона прямо в буфер пула
+                    cv::Mat frame = this->frame_pool->acquire();
+                    scene.render(frame_idx, frame);
+                    
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        reorder_buffer.emplace(frame_idx, std::move(frame));
+                    }
+                    cv_ready.notify_one();
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                is_aborted = true;
+                cv_ready.notify_all();
+                cv_space.notify_all();
+            }
+        };
+        
+        std::vector<std::thread> threads;
+        threads.reserve(this->count_workers);
+        for (uint32_t i = 0u; i < this->count_workers; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        
+        try
+        {
+            while (next_write < frame_end)
+            {
+                cv::Mat frame;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv_ready.wait(lock, [&]()
+                    {
+                        return
+                            is_aborted ||
+                            reorder_buffer.count(next_write) > 0u;
+                    });
+                    
+                    if (is_aborted)
+                    {
+                        break;
+                    }
+                    
+                    std::map<uint32_t, cv::Mat>::iterator it =
+                        reorder_buffer.begin();
+                    frame = std::move(it->second);
+                    reorder_buffer.erase(it);
+                }
+                
+                write(next_write, frame);
+                
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++next_write;
+                }
+                cv_space.notify_all();
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            is_aborted = true;
+            cv_space.notify_all();
+        }
+        
+        {
+            // Пробуждаем потоки, если запись прервалась
+            std::lock_guard<std::mutex> lock(mutex);
+            if (next_write < frame_end)
+            {
+                is_aborted = true;
+            }
+        }
+        cv_space.notify_all();
+        
+        for (std::thread &t : threads)
+        {
+            t.join();
+        }
+        
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    
+}
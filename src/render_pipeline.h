@@ -0,0 +1,62 @@
+#ifndef INSOMNIA_RENDER_PIPELINE_H
+#define INSOMNIA_RENDER_PIPELINE_H
+
+#include <functional>
+#include <map>
+
+#include <opencv2/opencv.hpp>
+
+#include "scene.h"
+#include "frame_pool.h"
+
+namespace InSomnia
+{
+    // Получатель готовых кадров, вызывается строго по порядку
+    using Frame_Write_Function = std::function<
+        void(const uint32_t frame_idx, const cv::Mat &frame)>;
+    
+    // Покадрово-параллельный рендер: count_workers потоков,
+    // у каждого своя сцена, берут номера кадров из общего счётчика.
+    // Готовые кадры ждут в буфере переупорядочивания и уходят
+    // в write по возрастанию номера. Поток не начинает кадр,
+    // который дальше max_depth от ещё не записанного, так что
+    // в памяти не больше max_depth кадров. Кадры рисуются
+    // в буферы frame_pool; вернуть их в пул — дело получателя
+    class Render_Pipeline
+    {
+    public:
+        Render_Pipeline();
+        
+        Render_Pipeline(
+            const Scene_Config &config,
+            const uint32_t count_workers,
+            const uint32_t max_depth,
+            Frame_Pool &frame_pool);
+        
+        // Рендерит все кадры сцены; write вызывается в потоке
+        // вызывающего. Исключение из потока рендера
+        // пробрасывается отсюда
+        void run(const Frame_Write_Function &write);
+        
+        // Только кадры [frame_begin, frame_end): сцены перематываются
+        // к frame_begin и дают те же кадры, что и полный проход
+        void run(
+            const uint32_t frame_begin,
+            const uint32_t frame_end,
+            const Frame_Write_Function &write);
+        
+        // Состояние сцены из контрольной точки: сцены потоков
+        // начинают с него, а не перематываются с кадра 0.
+        // Следующий run должен начинаться с кадра этой точки
+        void set_initial_state(const std::vector<uint8_t> &state_scene);
+        
+    private:
+        Scene_Config config;
+        uint32_t count_workers;
+        uint32_t max_depth;
+        Frame_Pool *frame_pool;
+        std::vector<uint8_t> state_initial;
+    };
+}
+
+#endif
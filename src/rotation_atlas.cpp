@@ -0,0 +1,88 @@
+#include "rotation_atlas.h"
+
+namespace InSomnia
+{
+    Rotation_Atlas::Rotation_Atlas()
+    {
+        
+    }
+    
+    Rotation_Atlas::Rotation_Atlas(
+        const cv::Mat &img,
+        const uint32_t count_angles)
+    {
+        if (img.empty() || img.channels() != 4 || count_angles == 0u)
+        {
+            throw std::runtime_error(
+                "Ошибка: неверные данные для Rotation_Atlas\n");
+        }
+        
+        const cv::Point2f center(
+            img.cols / 2.0f,
+            img.rows / 2.0f);
+        
+        this->sprites = std::vector<Sprite>(count_angles);
+        this->sprites_yuv = std::vector<Yuv_Sprite>(count_angles);
+        
+        for (uint32_t i = 0u; i < count_angles; ++i)
+        {
+            const double angle = 360.0 * i / count_angles;
+            
+            const cv::Mat rotation_matrix =
+                cv::getRotationMatrix2D(center, angle, 1.0);
+            
+            cv::Mat rotated_img;
+            cv::warpAffine(
+                img,
+                rotated_img,
+                rotation_matrix,
+                img.size(),
+                cv::INTER_LINEAR,
+                cv::BORDER_CONSTANT,
+                cv::Scalar(0, 0, 0, 0));
+            
+            this->sprites[i] = Sprite(rotated_img);
+            this->sprites_yuv[i] = Yuv_Sprite(this->sprites[i]);
+        }
+    }
+    
+    uint32_t Rotation_Atlas::get_count_angles() const
+    {
+        return this->sprites.size();
+    }
+    
+    uint32_t Rotation_Atlas::angle_to_index(const float angle) const
+    {
+        const uint32_t count = this->sprites.size();
+        
+        float a = std::fmod(angle, 360.f);
+        if (a < 0.f)
+        {
+            a += 360.f;
+        }
+        
+        const uint32_t idx = static_cast<uint32_t>(
+            std::lround(a / 360.f * count));
+        
+        return idx % count;
+    }
+    
+    const Sprite& Rotation_Atlas::get_sprite(
+        const uint32_t idx_angle) const
+    {
+        return this->sprites[idx_angle];
+    }
+    
+    const Sprite& Rotation_Atlas::get_sprite_by_angle(
+        const float angle) const
+    {
+        return this->sprites[this->angle_to_index(angle)];
+    }
+    
+    const Yuv_Sprite& Rotation_Atlas::get_sprite_yuv(
+        const uint32_t idx_angle) const
+    {
+        return this->sprites_yuv[idx_angle];
+    }
+    
+}
@@ -0,0 +1,45 @@
+#ifndef INSOMNIA_ROTATION_ATLAS_H
+#define INSOMNIA_ROTATION_ATLAS_H
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "sprite.h"
+#include "yuv_sprite.h"
+
+namespace InSomnia
+{
+    // Изображение, заранее повёрнутое на count_angles равных шагов
+    // по 360 / count_angles градусов. Поворот на кадре сводится
+    // к выбору готового обрезанного спрайта
+    class Rotation_Atlas
+    {
+    public:
+        Rotation_Atlas();
+        
+        // img — BGRA; поворот вокруг центра без изменения размера,
+        // как в прежнем Snowflake::rotate
+        Rotation_Atlas(
+            const cv::Mat &img,
+            const uint32_t count_angles);
+        
+        uint32_t get_count_angles() const;
+        
+        // Ближайший индекс для угла в градусах (любого знака)
+        uint32_t angle_to_index(const float angle) const;
+        
+        const Sprite& get_sprite(const uint32_t idx_angle) const;
+        
+        const Sprite& get_sprite_by_angle(const float angle) const;
+        
+        // Тот же спрайт для кадра YUV 4:2:0
+        const Yuv_Sprite& get_sprite_yuv(const uint32_t idx_angle) const;
+        
+    private:
+        std::vector<Sprite> sprites;
+        std::vector<Yuv_Sprite> sprites_yuv;
+    };
+}
+
+#endif
@@ -0,0 +1,292 @@
+#include "scene.h"
+
+namespace InSomnia
+{
+    Scene::Scene(const Scene_Config &config)
+    {
+        this->config = config;
+        
+        const int width = config.width;
+        const int height = config.height;
+        const int fps = config.fps;
+        const uint32_t total_frames = config.total_frames;
+        const uint64_t seed = config.seed;
+        
+        // Snow
+        
+        const std::string path_file_snowflake =
+            config.dir_img + "/snow.png";
+        
+        const std::vector<Interval_Snow> schedule_snowfall =
+        {
+            { 0., 30., 200, 0, 0 }
+            // { 30., 50., 500, 0, 0 }
+        };
+        
+        this->snowfall = Snowfall(
+            path_file_snowflake,
+            schedule_snowfall,
+            fps,
+            total_frames,
+            height,
+            seed + 1);
+        
+        // Fir
+        
+        const std::string path_file_fir =
+            config.dir_img + "/tree.png";
+        
+        this->coord_fir_x = width * 0.5f;
+        this->coord_fir_y = height * 0.5f;
+        
+        static constexpr float scale_fir = 0.8;
+        
+        this->fir = Fir(
+            path_file_fir, width, height, scale_fir);
+        
+        // Light
+        
+        const cv::Mat &img_fir = this->fir.get_img();
+        
+        const std::vector<cv::Scalar> colors_lamps =
+        {
+            { 0, 0, 255 },   // blue
+            { 0, 255, 0 },   // green
+            { 255, 0, 0 },   // red
+            { 0, 255, 255 }  // yellow
+        };
+        
+        const std::vector<State_Lamps> vec_state_lamps =
+        {
+            { { false, false, false, true }, 1., 0u },
+            { { false, false, true, false }, 1., 0u },
+            { { false, true, false, false }, 1., 0u },
+            { { true, false, false, false }, 1., 0u },
+            
+            { { false, false, true, true }, 1., 0u },
+            { { false, true, true, false }, 1., 0u },
+            { { true, true, false, false }, 1., 0u },
+            { { true, false, false, true }, 1., 0u },
+            
+            { { false, true, true, true }, 0.5, 0u },
+            { { true, true, true, false }, 0.5, 0u },
+            { { true, true, false, true }, 0.5, 0u },
+            { { true, false, true, true }, 0.5, 0u }
+        };
+        
+        static constexpr double scale = 0.003;
+        
+        this->light = Light(
+            img_fir,
+            colors_lamps,
+            vec_state_lamps,
+            width,
+            height,
+            fps,
+            scale);
+        
+        const uint32_t count_lamps = 50u;
+        this->light.generate_lights_inside_tree_by_alpha(
+            count_lamps, seed + 2);
+        
+        this->light.build_timeline(total_frames);
+        
+        this->light.convert_tree_coords_to_frame_coords(
+            this->coord_fir_x, this->coord_fir_y);
+        
+        // Hare
+        
+        const std::string path_file_hare =
+            config.dir_img + "/hare.png";
+        
+        const float scale_hare = 0.2;
+        
+        // Физические параметры (в пикселях и кадрах)
+        const double g_pixels_per_sec_sq = 9.8 * height * 0.08; // Ускорение "гравитации"
+        const double vx_per_jump = width * 0.14; // Скорость вперёд за прыжок (пикс/сек)
+        const double vy_initial = - height * 0.42; // Начальная скорость вверх (пикс/сек)
+        const double ground_y = height * 0.8; // Уровень "земли"
+        
+        const double start_x = width * 0.2;
+        const double jump_interval = 0.8;
+        
+        this->hare = Hare(
+            path_file_hare,
+            width,
+            height,
+            scale_hare,
+            g_pixels_per_sec_sq,
+            vx_per_jump,
+            vy_initial,
+            ground_y,
+            start_x,
+            jump_interval);
+        
+        this->hare.build_trajectory(total_frames, fps);
+        
+        // Стая зайцев позади: мельче и выше по кадру, чем главный заяц
+        const uint32_t count_hares_crowd = 48u;
+        
+        this->hare_crowd = Hare_Crowd(
+            path_file_hare,
+            width,
+            height,
+            count_hares_crowd,
+            8u,
+            0.05f,
+            0.12f,
+            g_pixels_per_sec_sq,
+            vx_per_jump * 0.5,
+            vy_initial * 0.5,
+            height * 0.64,
+            height * 0.76,
+            0.4,
+            1.2,
+            fps,
+            seed + 4);
+        
+        // Snow cover
+        
+        // Плотность как у 15'000 снежков на кадре 4K,
+        // при 1920 x 1080 снежков будет вчетверо меньше
+        static constexpr float density_snowballs =
+            15'000.f / (3840.f * 2160.f / 1'000'000.f);
+        static constexpr float scale_snowball = 0.0015f;
+        
+        // heightfield — сугроб по карте высот: O(width) памяти
+        // и без состояния на каждый снежок
+        this->snow_cover = Snow_Cover(
+            width,
+            height,
+            density_snowballs,
+            scale_snowball,
+            cv::Scalar(200, 200, 200),
+            Snow_Cover_Engine::snowballs,
+            seed + 3);
+        
+        // Layers (снизу вверх)
+        
+        this->layer_stack = Layer_Stack(width, height, CV_8UC3);
+        
+        this->layer_stack.add_layer(
+            "snow_cover",
+            Layer_Kind::dynamic_layer,
+            [this](const uint32_t frame_idx, cv::Mat &frame)
+            {
+                this->snow_cover.render(
+                    frame_idx, this->config.total_frames, frame);
+            },
+            [this](const uint32_t frame_idx, Frame_Yuv420 &frame)
+            {
+                this->snow_cover.render(
+                    frame_idx, this->config.total_frames, frame);
+            });
+        
+        this->layer_stack.add_layer(
+            "snowfall",
+            Layer_Kind::dynamic_layer,
+            [this](const uint32_t frame_idx, cv::Mat &frame)
+            {
+                this->snowfall.render(
+                    frame_idx, this->config.width, this->config.height, frame);
+            },
+            [this](const uint32_t frame_idx, Frame_Yuv420 &frame)
+            {
+                this->snowfall.render(
+                    frame_idx, this->config.width, this->config.height, frame);
+            });
+        
+        // Ёлка не зависит от кадра и запекается один раз
+        this->layer_stack.add_layer(
+            "fir",
+            Layer_Kind::static_layer,
+            [this](const uint32_t frame_idx, cv::Mat &frame)
+            {
+                this->fir.render(
+                    frame_idx, this->coord_fir_x, this->coord_fir_y, frame);
+            });
+        
+        this->layer_stack.add_layer(
+            "light",
+            Layer_Kind::dynamic_layer,
+            [this](const uint32_t frame_idx, cv::Mat &frame)
+            {
+                this->light.render(frame_idx, frame);
+            },
+            [this](const uint32_t frame_idx, Frame_Yuv420 &frame)
+            {
+                this->light.render(frame_idx, frame);
+            });
+        
+        this->layer_stack.add_layer(
+            "hare_crowd",
+            Layer_Kind::dynamic_layer,
+            [this](const uint32_t frame_idx, cv::Mat &frame)
+            {
+                this->hare_crowd.render(frame_idx, frame);
+            },
+            [this](const uint32_t frame_idx, Frame_Yuv420 &frame)
+            {
+                this->hare_crowd.render(frame_idx, frame);
+            });
+        
+        this->layer_stack.add_layer(
+            "hare",
+            Layer_Kind::dynamic_layer,
+            [this](const uint32_t frame_idx, cv::Mat &frame)
+            {
+                this->hare.render(frame_idx, frame);
+            },
+            [this](const uint32_t frame_idx, Frame_Yuv420 &frame)
+            {
+                this->hare.render(frame_idx, frame);
+            });
+        
+        if (config.format == Frame_Format::yuv420 &&
+            !(this->layer_stack.supports_yuv()))
+        {
+            throw std::runtime_error(
+                "Ошибка: не все слои сцены умеют рисовать в YUV\n");
+        }
+    }
+    
+    void Scene::render(
+        const uint32_t frame_idx,
+        cv::Mat &frame)
+    {
+        // Кадр начинается с копии закешированного фона
+        if (this->config.format == Frame_Format::yuv420)
+        {
+            Frame_Yuv420 frame_yuv(frame);
+            this->layer_stack.render(frame_idx, frame_yuv);
+            return;
+        }
+        
+        this->layer_stack.render(frame_idx, frame);
+    }
+    
+    void Scene::seek(const uint32_t frame_idx)
+    {
+        this->snowfall.seek(
+            frame_idx, this->config.width, this->config.height);
+        this->snow_cover.seek(frame_idx, this->config.total_frames);
+    }
+    
+    void Scene::save_state(Binary_Writer &writer) const
+    {
+        this->snowfall.save_state(writer);
+        this->snow_cover.save_state(writer);
+    }
+    
+    void Scene::load_state(Binary_Reader &reader)
+    {
+        this->snowfall.load_state(reader);
+        this->snow_cover.load_state(reader);
+    }
+    
+    const Scene_Config& Scene::get_config() const
+    {
+        return this->config;
+    }
+    
+}
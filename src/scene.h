@@ -0,0 +1,78 @@
+#ifndef INSOMNIA_SCENE_H
+#define INSOMNIA_SCENE_H
+
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+#include "snowflake.h"
+#include "fir.h"
+#include "light.h"
+#include "hare.h"
+#include "hare_crowd.h"
+#include "snow_cover.h"
+#include "layer_stack.h"
+#include "frame_yuv420.h"
+#include "binary_io.h"
+
+namespace InSomnia
+{
+    struct Scene_Config
+    {
+        int width;
+        int height;
+        int fps;
+        uint32_t total_frames;
+        std::string dir_img;
+        uint64_t seed; // Один seed на всю сцену
+        Frame_Format format; // Для yuv420 кадр — буфер I420
+    };
+    
+    // Новогодняя сцена целиком: компоненты и стек слоёв.
+    // Любой кадр рисуется независимо от остальных, поэтому
+    // каждый поток рендера строит свою сцену. Неизменяемые
+    // атласы снежинок при этом общие
+    class Scene
+    {
+    public:
+        explicit Scene(const Scene_Config &config);
+        
+        // Слои ссылаются на компоненты сцены
+        Scene(const Scene &) = delete;
+        Scene& operator=(const Scene &) = delete;
+        
+        // frame — CV_8UC3 или буфер I420, по config.format
+        void render(
+            const uint32_t frame_idx,
+            cv::Mat &frame);
+        
+        // Все компоненты — в состояние перед кадром frame_idx,
+        // без отрисовки
+        void seek(const uint32_t frame_idx);
+        
+        // Состояние компонентов для контрольной точки.
+        // Гирлянда и заяц состояния не имеют: всё считается по кадру
+        void save_state(Binary_Writer &writer) const;
+        
+        void load_state(Binary_Reader &reader);
+        
+        const Scene_Config& get_config() const;
+        
+    private:
+        Scene_Config config;
+        
+        float coord_fir_x;
+        float coord_fir_y;
+        
+        Snowfall snowfall;
+        Fir fir;
+        Light light;
+        Hare hare;
+        Hare_Crowd hare_crowd;
+        Snow_Cover snow_cover;
+        
+        Layer_Stack layer_stack;
+    };
+}
+
+#endif
@@ -0,0 +1,505 @@
+#include "segmented_render.h"
+
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <thread>
+
+#include "async_encoder.h"
+#include "binary_io.h"
+#include "checkpoint.h"
+#include "frame_pool.h"
+#include "frame_yuv420.h"
+#include "render_pipeline.h"
+
+namespace InSomnia
+{
+    std::vector<Segment> split_segments(
+        const uint32_t frame_begin,
+        const uint32_t frame_end,
+        const uint32_t count_segments,
+        const std::string &path_output)
+    {
+        if (frame_begin >= frame_end)
+        {
+            throw std::runtime_error(
+                "Ошибка: пустой диапазон кадров\n");
+        }
+        
+        const uint32_t count_frames = frame_end - frame_begin;
+        
+        if (count_segments == 0u || count_segments > count_frames)
+        {
+            throw std::runtime_error(
+                "Ошибка: неверное число сегментов\n");
+        }
+        
+        const std::filesystem::path path(path_output);
+        
+        std::vector<Segment> segments(count_segments);
+        
+        for (uint32_t i = 0u; i < count_segments; ++i)
+        {
+            Segment &segment = segments[i];
+            
+            segment.idx = i;
+            segment.frame_begin = frame_begin + static_cast<uint32_t>(
+                static_cast<uint64_t>(count_frames) * i / count_segments);
+            segment.frame_end = frame_begin + static_cast<uint32_t>(
+                static_cast<uint64_t>(count_frames) * (i + 1) / count_segments);
+            
+            if (count_segments == 1u)
+            {
+                segment.path_file = path_output;
+                continue;
+            }
+            
+            std::filesystem::path path_part = path;
+            path_part.replace_filename(std::format(
+                "{}.part{:03}{}",
+                path.stem().string(), i, path.extension().string()));
+            segment.path_file = path_part.string();
+        }
+        
+        return segments;
+    }
+    
+    std::vector<std::string> get_segment_paths(
+        const std::vector<Segment> &segments)
+    {
+        std::vector<std::string> paths;
+        paths.reserve(segments.size());
+        
+        for (const Segment &segment : segments)
+        {
+            paths.push_back(segment.path_file);
+        }
+        
+        return paths;
+    }
+    
+    Segmented_Render::Segmented_Render(
+        const Scene_Config &config,
+        const std::vector<Segment> &segments,
+        const uint32_t count_workers,
+        const uint32_t capacity_encoder,
+        const bool use_huge_pages,
+        const uint32_t checkpoint_interval,
+        const bool is_resume)
+    {
+        if (segments.empty() || count_workers == 0u || capacity_encoder == 0u)
+        {
+            throw std::runtime_error(
+                "Ошибка: неверные параметры Segmented_Render\n");
+        }
+        
+        this->config = config;
+        this->segments = segments;
+        this->count_workers = count_workers;
+        this->capacity_encoder = capacity_encoder;
+        this->use_huge_pages = use_huge_pages;
+        this->checkpoint_interval = checkpoint_interval;
+        this->is_resume = is_resume;
+        
+        this->queue_stats = std::vector<Frame_Queue_Stats>(segments.size());
+        this->sink_stats = std::vector<Sink_Stats>(segments.size());
+        this->sink_starts =
+            std::vector<std::vector<uint32_t>>(segments.size());
+    }
+    
+    void Segmented_Render::run(
+        const Segment_Sink_Function &make_sink,
+        const Segment_Progress_Function &progress)
+    {
+        const uint32_t count_segments = this->segments.size();
+        
+        // Потоки рендера поровну, остаток — первым сегментам
+        const uint32_t count_base =
+            std::max(1u, this->count_workers / count_segments);
+        const uint32_t count_extra =
+            this->count_workers > count_segments ?
+                this->count_workers % count_segments : 0u;
+        
+        std::mutex mutex_progress;
+        std::atomic<uint32_t> count_done(0u);
+        
+        const std::function<void()> on_frame =
+            [&mutex_progress, &count_done, &progress]()
+            {
+                const uint32_t count = count_done.fetch_add(1u) + 1u;
+                
+                std::lock_guard<std::mutex> lock(mutex_progress);
+                progress(count);
+            };
+        
+        std::vector<std::exception_ptr> errors(count_segments);
+        std::vector<std::thread> threads;
+        threads.reserve(count_segments);
+        
+        for (uint32_t i = 0u; i < count_segments; ++i)
+        {
+            const uint32_t count_workers_segment =
+                count_base + (i < count_extra ? 1u : 0u);
+            
+            threads.emplace_back(
+                [this, i, count_workers_segment, &make_sink, &on_frame, &errors]()
+                {
+                    try
+                    {
+                        this->run_segment(
+                            this->segments[i],
+                            count_workers_segment,
+                            make_sink,
+                            on_frame);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                });
+        }
+        
+        for (std::thread &t : threads)
+        {
+            t.join();
+        }
+        
+        for (const std::exception_ptr &error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+    
+    void Segmented_Render::run_segment(
+        const Segment &segment,
+        const uint32_t count_workers_segment,
+        const Segment_Sink_Function &make_sink,
+        const std::function<void()> &on_frame)
+    {
+        const std::string path_checkpoint = get_checkpoint_path(segment);
+        
+        Checkpoint checkpoint;
+        checkpoint.width = this->config.width;
+        checkpoint.height = this->config.height;
+        checkpoint.fps = this->config.fps;
+        checkpoint.total_frames = this->config.total_frames;
+        checkpoint.seed = this->config.seed;
+        checkpoint.format = this->config.format;
+        checkpoint.frame_begin = segment.frame_begin;
+        checkpoint.frame_end = segment.frame_end;
+        checkpoint.frame_next = segment.frame_begin;
+        
+        if (this->is_resume && load_checkpoint(path_checkpoint, checkpoint) &&
+            !is_checkpoint_for(
+                checkpoint,
+                this->config,
+                segment.frame_begin,
+                segment.frame_end))
+        {
+            throw std::runtime_error(
+                "Ошибка: контрольная точка " + path_checkpoint +
+                " снята с другими настройками\n");
+        }
+        
+        std::vector<uint32_t> &sink_starts = this->sink_starts[segment.idx];
+        sink_starts = checkpoint.frames_sink_start;
+        
+        // Сегмент уже дорисован до продолжения
+        const uint32_t frame_first = checkpoint.frame_next;
+        if (frame_first >= segment.frame_end)
+        {
+            return;
+        }
+        
+        const uint32_t max_depth = 2u * count_workers_segment;
+        
+        // Буфер I420 — одна плоскость CV_8UC1 в полтора раза выше кадра
+        const bool is_yuv420 = this->config.format == Frame_Format::yuv420;
+        const cv::Size size_buffer = is_yuv420 ?
+            get_yuv420_buffer_size(this->config.width, this->config.height) :
+            cv::Size(this->config.width, this->config.height);
+        
+        // Буферов хватает на кадры в рендере и буфере переупорядочивания,
+        // в очереди кодировщика и по одному у записи и кодировщика
+        Frame_Pool frame_pool(
+            size_buffer.width,
+            size_buffer.height,
+            is_yuv420 ? CV_8UC1 : CV_8UC3,
+            max_depth + this->capacity_encoder + 2u,
+            this->use_huge_pages);
+        
+        Render_Pipeline render_pipeline(
+            this->config, count_workers_segment, max_depth, frame_pool);
+        render_pipeline.set_initial_state(checkpoint.state_scene);
+        
+        // Отдельная сцена для снятия состояния: кадры она не рисует,
+        // только перематывается от точки к точке в потоке кодировщика
+        std::unique_ptr<Scene> scene_checkpoint;
+        if (this->checkpoint_interval > 0u)
+        {
+            scene_checkpoint = std::make_unique<Scene>(this->config);
+            
+            if (!(checkpoint.state_scene.empty()))
+            {
+                Binary_Reader reader(
+                    checkpoint.state_scene.data(),
+                    checkpoint.state_scene.size());
+                scene_checkpoint->load_state(reader);
+            }
+        }
+        
+        Sink_Stats sink_stats = Sink_Stats();
+        
+        std::unique_ptr<Frame_Sink> sink = make_sink(segment, frame_first);
+        sink_starts.push_back(frame_first);
+        
+        // Закрывает приёмник: кадры до frame_next на диске
+        auto close_sink = [&sink, &sink_stats]()
+        {
+            sink->close();
+            
+            const Sink_Stats stats = sink->get_stats();
+            sink_stats.count_frames += stats.count_frames;
+            sink_stats.bytes_written += stats.bytes_written;
+            sink_stats.seconds += stats.seconds;
+        };
+        
+        auto write_checkpoint = [&](const uint32_t frame_next)
+        {
+            checkpoint.frame_next = frame_next;
+            checkpoint.frames_sink_start = sink_starts;
+            checkpoint.state_scene.clear();
+            
+            if (frame_next < segment.frame_end)
+            {
+                scene_checkpoint->seek(frame_next);
+                
+                Binary_Writer writer;
+                scene_checkpoint->save_state(writer);
+                checkpoint.state_scene = writer.get_data();
+            }
+            
+            save_checkpoint(path_checkpoint, checkpoint);
+        };
+        
+        Async_Encoder encoder(
+            [&](const uint32_t frame_idx, const cv::Mat &frame)
+            {
+                sink->push(frame_idx, frame);
+                
+                frame_pool.release(frame);
+                
+                on_frame();
+                
+                const uint32_t frame_next = frame_idx + 1u;
+                
+                if (this->checkpoint_interval == 0u ||
+                    frame_next >= segment.frame_end ||
+                    (frame_next - segment.frame_begin) %
+                        this->checkpoint_interval != 0u)
+                {
+                    return;
+                }
+                
+                // Точка пишется только после закрытия приёмника,
+                // иначе она могла бы обещать кадры, которых нет
+                close_sink();
+                write_checkpoint(frame_next);
+                
+                sink = make_sink(segment, frame_next);
+                sink_starts.push_back(frame_next);
+            },
+            this->capacity_encoder);
+        
+        render_pipeline.run(
+            frame_first,
+            segment.frame_end,
+            [&encoder](const uint32_t frame_idx, const cv::Mat &frame)
+            {
+                encoder.push(frame_idx, frame);
+            });
+        
+        encoder.close();
+        
+        close_sink();
+        
+        // Отметка о законченном сегменте для продолжения
+        if (this->checkpoint_interval > 0u)
+        {
+            write_checkpoint(segment.frame_end);
+        }
+        
+        // Каждый сегмент пишет только свою ячейку
+        this->queue_stats[segment.idx] = encoder.get_stats();
+        this->sink_stats[segment.idx] = sink_stats;
+    }
+    
+    const std::vector<Segment>& Segmented_Render::get_segments() const
+    {
+        return this->segments;
+    }
+    
+    const std::vector<Frame_Queue_Stats>&
+    Segmented_Render::get_queue_stats() const
+    {
+        return this->queue_stats;
+    }
+    
+    Sink_Stats Segmented_Render::get_sink_stats() const
+    {
+        Sink_Stats total = Sink_Stats();
+        
+        for (const Sink_Stats &stats : this->sink_stats)
+        {
+            total.count_frames += stats.count_frames;
+            total.bytes_written += stats.bytes_written;
+            total.seconds += stats.seconds;
+        }
+        
+        return total;
+    }
+    
+    const std::vector<std::vector<uint32_t>>&
+    Segmented_Render::get_sink_starts() const
+    {
+        return this->sink_starts;
+    }
+    
+    void Segmented_Render::remove_checkpoints() const
+    {
+        for (const Segment &segment : this->segments)
+        {
+            std::filesystem::remove(get_checkpoint_path(segment));
+        }
+    }
+    
+    std::string get_checkpoint_path(const Segment &segment)
+    {
+        return segment.path_file + ".ckpt";
+    }
+    
+    void write_concat_manifest(
+        const std::string &path_manifest,
+        const std::vector<std::string> &paths_parts)
+    {
+        std::ofstream file(path_manifest);
+        
+        if (!file)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось открыть файл " + path_manifest + "\n");
+        }
+        
+        // Пути абсолютные: список можно положить куда угодно
+        for (const std::string &path_part : paths_parts)
+        {
+            file << "file '"
+                 << std::filesystem::absolute(path_part).string()
+                 << "'\n";
+        }
+        
+        if (!file)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось записать " + path_manifest + "\n");
+        }
+    }
+    
+    void join_y4m_parts(
+        const std::vector<std::string> &paths_parts,
+        const std::string &path_output,
+        const bool remove_parts)
+    {
+        // Пишем рядом во временный файл: прежний выход
+        // не трогается, пока склейка не удалась целиком
+        const std::string path_temp = path_output + ".tmp";
+        
+        std::FILE *output = std::fopen(path_temp.c_str(), "wb");
+        
+        if (output == nullptr)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось открыть файл " + path_temp + "\n");
+        }
+        
+        std::vector<char> buffer(8u << 20);
+        bool is_ok = true;
+        
+        std::string header_first;
+        std::string error_message =
+            "Ошибка: не удалось склеить части Y4M в " + path_output + "\n";
+        
+        for (uint32_t i = 0u; i < paths_parts.size() && is_ok; ++i)
+        {
+            std::FILE *input = std::fopen(paths_parts[i].c_str(), "rb");
+            if (input == nullptr)
+            {
+                is_ok = false;
+                break;
+            }
+            
+            // Заголовок потока — первая строка части
+            std::string header;
+            int c = 0;
+            while ((c = std::fgetc(input)) != EOF && c != '\n')
+            {
+                header.push_back(static_cast<char>(c));
+            }
+            is_ok = (c == '\n');
+            
+            if (i == 0u)
+            {
+                header_first = header;
+                header.push_back('\n');
+                is_ok = is_ok &&
+                    std::fwrite(header.data(), 1, header.size(), output) ==
+                        header.size();
+            }
+            else if (header != header_first)
+            {
+                is_ok = false;
+                error_message =
+                    "Ошибка: заголовок " + paths_parts[i] +
+                    " не совпадает с первой частью\n";
+            }
+            
+            size_t count = 0u;
+            while (is_ok &&
+                   (count = std::fread(buffer.data(), 1, buffer.size(), input)) > 0u)
+            {
+                is_ok = std::fwrite(buffer.data(), 1, count, output) == count;
+            }
+            
+            is_ok = is_ok && !std::ferror(input);
+            std::fclose(input);
+        }
+        
+        is_ok = (std::fclose(output) == 0) && is_ok;
+        
+        if (!is_ok)
+        {
+            // Недоклеенный файл не должен сойти за результат
+            std::filesystem::remove(path_temp);
+            throw std::runtime_error(error_message);
+        }
+        
+        std::filesystem::rename(path_temp, path_output);
+        
+        if (!remove_parts)
+        {
+            return;
+        }
+        
+        for (const std::string &path_part : paths_parts)
+        {
+            std::filesystem::remove(path_part);
+        }
+    }
+    
+}
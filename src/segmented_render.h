@@ -0,0 +1,138 @@
+#ifndef INSOMNIA_SEGMENTED_RENDER_H
+#define INSOMNIA_SEGMENTED_RENDER_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "scene.h"
+#include "frame_sink.h"
+#include "frame_queue.h"
+
+namespace InSomnia
+{
+    // Непрерывный кусок видео [frame_begin, frame_end)
+    // со своим выходным файлом
+    struct Segment
+    {
+        uint32_t idx;
+        uint32_t frame_begin;
+        uint32_t frame_end;
+        std::string path_file;
+    };
+    
+    // Приёмник для сегмента, создаётся в потоке сегмента.
+    // frame_first — первый кадр, который в него придёт: больше
+    // segment.frame_begin после контрольной точки или продолжения
+    using Segment_Sink_Function = std::function<
+        std::unique_ptr<Frame_Sink>(
+            const Segment &segment,
+            const uint32_t frame_first)>;
+    
+    // Сколько кадров уже отдано приёмникам во всех сегментах.
+    // Вызовы не пересекаются по времени
+    using Segment_Progress_Function = std::function<
+        void(const uint32_t count_done)>;
+    
+    // Делит [frame_begin, frame_end) на count_segments подряд
+    // идущих частей почти равной длины. Части называются как
+    // path_output с суффиксом: result.mp4 -> result.part000.mp4.
+    // Для одной части путь не меняется
+    std::vector<Segment> split_segments(
+        const uint32_t frame_begin,
+        const uint32_t frame_end,
+        const uint32_t count_segments,
+        const std::string &path_output);
+    
+    std::vector<std::string> get_segment_paths(
+        const std::vector<Segment> &segments);
+    
+    // Рендер видео сегментами: у каждого сегмента свой поток-
+    // руководитель, свой пул кадров, свой Render_Pipeline и свой
+    // кодировщик с приёмником, так что кодирование тоже идёт
+    // параллельно. Сцены перематываются к началу сегмента,
+    // поэтому стыки совпадают с последовательным рендером.
+    //
+    // Каждые checkpoint_interval кадров сегмента приёмник
+    // закрывается, а в path_file.ckpt пишется контрольная точка:
+    // состояние сцены и первый незаписанный кадр. Следующие кадры
+    // идут в новый приёмник. С is_resume сегмент продолжается
+    // с последней точки, а законченный пропускается
+    class Segmented_Render
+    {
+    public:
+        // count_workers потоков рендера делятся между сегментами.
+        // checkpoint_interval = 0 — без контрольных точек
+        Segmented_Render(
+            const Scene_Config &config,
+            const std::vector<Segment> &segments,
+            const uint32_t count_workers,
+            const uint32_t capacity_encoder,
+            const bool use_huge_pages,
+            const uint32_t checkpoint_interval,
+            const bool is_resume);
+        
+        // Ошибка любого сегмента пробрасывается после того,
+        // как остальные сегменты закончат
+        void run(
+            const Segment_Sink_Function &make_sink,
+            const Segment_Progress_Function &progress);
+        
+        const std::vector<Segment>& get_segments() const;
+        
+        // Статистика очереди кодировщика по сегментам
+        const std::vector<Frame_Queue_Stats>& get_queue_stats() const;
+        
+        // Сумма по приёмникам всех сегментов
+        Sink_Stats get_sink_stats() const;
+        
+        // Первые кадры всех приёмников сегмента по порядку,
+        // включая созданные до продолжения
+        const std::vector<std::vector<uint32_t>>& get_sink_starts() const;
+        
+        // После успешного run точки больше не нужны
+        void remove_checkpoints() const;
+        
+    private:
+        Scene_Config config;
+        std::vector<Segment> segments;
+        uint32_t count_workers;
+        uint32_t capacity_encoder;
+        bool use_huge_pages;
+        uint32_t checkpoint_interval;
+        bool is_resume;
+        
+        std::vector<Frame_Queue_Stats> queue_stats;
+        std::vector<Sink_Stats> sink_stats;
+        std::vector<std::vector<uint32_t>> sink_starts;
+        
+        void run_segment(
+            const Segment &segment,
+            const uint32_t count_workers_segment,
+            const Segment_Sink_Function &make_sink,
+            const std::function<void()> &on_frame);
+    };
+    
+    std::string get_checkpoint_path(const Segment &segment);
+    
+    // Список частей в формате concat для ffmpeg:
+    // ffmpeg -f concat -safe 0 -i <manifest> -c copy result.mp4
+    void write_concat_manifest(
+        const std::string &path_manifest,
+        const std::vector<std::string> &paths_parts);
+    
+    // Склеивает части Y4M без потерь: заголовок первой части,
+    // затем кадры всех частей по порядку. Заголовки частей
+    // должны совпадать. Выход заменяется только после удачной
+    // склейки. remove_parts — удалить части после склейки
+    void join_y4m_parts(
+        const std::vector<std::string> &paths_parts,
+        const std::string &path_output,
+        const bool remove_parts);
+}
+
+#endif
@@ -1,25 +1,85 @@
 #include "snow_cover.h"
 
+#include "compositor.h"
+#include "toolbox.h"
+
 namespace InSomnia
 {
 
     Snow_Cover::Snow_Cover()
+        : Snow_Cover(
+            3840,
+            2160,
+            15'000.f / (3840.f * 2160.f / 1'000'000.f),
+            0.0015f,
+            cv::Scalar(200, 200, 200),
+            Snow_Cover_Engine::snowballs,
+            0u)
+    {
+        
+    }
+    
+    Snow_Cover::Snow_Cover(
+        const int width,
+        const int height,
+        const float density_per_megapixel,
+        const float radius_scale,
+        const cv::Scalar &color,
+        const Snow_Cover_Engine engine,
+        const uint64_t seed)
     {
-        this->width = 3840;
-        this->height = 2160;
+        if (width <= 0 || height <= 0)
+        {
+            throw std::runtime_error(
+                "Ошибка: неверный размер кадра для Snow_Cover\n");
+        }
+        
+        this->engine = engine;
+        this->seed = seed;
+        this->next_frame = 0u;
+        
+        this->width = width;
+        this->height = height;
         this->diagonal =
-            std::sqrt(this->width * this->width +
-                      this->height * this->height);
+            std::sqrt(static_cast<float>(this->width) * this->width +
+                      static_cast<float>(this->height) * this->height);
         
-        this->scale = 0.0015;
+        this->scale = radius_scale;
         this->base_radius =
             this->diagonal * this->scale;
-        this->limit_snowballs = 15'000u;
-        this->color = cv::Scalar(200, 200, 200);
+        this->limit_snowballs = static_cast<uint32_t>(std::lround(
+            density_per_megapixel *
+            (static_cast<float>(this->width) * this->height / 1'000'000.f)));
+        this->color = color;
         
         this->max_y_lift = this->height * 1.f / 3.f;
         this->min_y_lift = this->height * 0.95f;
         this->current_y_lift = this->min_y_lift;
+        
+        this->count_stamped = 0u;
+        this->layer_top_y = this->height;
+        this->profile_amplitude = 0.f;
+        
+        const cv::Vec3f yuv = bgr_to_yuv(
+            this->color[0], this->color[1], this->color[2]);
+        for (int c = 0; c < 3; ++c)
+        {
+            this->color_yuv[c] = cv::saturate_cast<uchar>(yuv[c]);
+        }
+        
+        if (this->engine == Snow_Cover_Engine::heightfield)
+        {
+            this->init_heightfield();
+        }
+        else
+        {
+            this->layer =
+                cv::Mat::zeros(this->height, this->width, CV_8UC4);
+            this->layer_alpha =
+                cv::Mat::zeros(this->height, this->width, CV_8UC1);
+            this->layer_alpha_chroma = cv::Mat::zeros(
+                (this->height + 1) / 2, (this->width + 1) / 2, CV_8UC1);
+        }
     }
     
     void Snow_Cover::render(
@@ -27,16 +87,13 @@ namespace InSomnia
         const uint32_t total_frames,
         cv::Mat &frame)
     {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
+        this->current_y_lift = this->get_y_lift(frame_idx, total_frames);
         
-        std::uniform_real_distribution<float>
-            dist_pos_x(0.f, this->width);
-        
-        this->current_y_lift =
-            this->min_y_lift -
-            (static_cast<float>(frame_idx) / (total_frames - 1)) *
-            (this->min_y_lift - this->max_y_lift);
+        if (this->engine == Snow_Cover_Engine::heightfield)
+        {
+            this->render_heightfield(frame);
+            return;
+        }
         
         // std::cout << std::format(
         //     "max_y_lift: {} "
@@ -45,52 +102,527 @@ namespace InSomnia
         //     this->max_y_lift, this->min_y_lift, this->current_y_lift);
         // std::cout.flush();
         
-        std::uniform_real_distribution<float>
-            dist_pos_y(this->current_y_lift, this->height);
+        this->add_snowballs(frame_idx, total_frames);
+        
+        this->stamp_new_snowballs();
         
-        const uint32_t count_need =
-            this->limit_snowballs *
-                (static_cast<float>(frame_idx) / (total_frames - 1));
+        this->composite_layer(frame);
+    }
+    
+    void Snow_Cover::render(
+        const uint32_t frame_idx,
+        const uint32_t total_frames,
+        Frame_Yuv420 &frame)
+    {
+        this->current_y_lift = this->get_y_lift(frame_idx, total_frames);
         
-        const uint32_t count_has =
-            this->vec_snowballs.size();
+        if (this->engine == Snow_Cover_Engine::heightfield)
+        {
+            this->render_heightfield(frame);
+            return;
+        }
         
-        const uint32_t count_gen =
-            count_need - count_has;
+        this->add_snowballs(frame_idx, total_frames);
         
-        // std::cout << std::format(
-        //     "count_need: {}\n"
-        //     "count_has: {}\n"
-        //     "count_gen: {}\n\n",
-        //     count_need, count_has, count_gen);
-        // std::cout.flush();
+        this->stamp_new_snowballs();
+        
+        this->composite_layer(frame);
+    }
+    
+    float Snow_Cover::get_y_lift(
+        const uint32_t frame_idx,
+        const uint32_t total_frames) const
+    {
+        return
+            this->min_y_lift -
+            (static_cast<float>(frame_idx) / (total_frames - 1)) *
+            (this->min_y_lift - this->max_y_lift);
+    }
+    
+    void Snow_Cover::add_snowballs(
+        const uint32_t frame_idx,
+        const uint32_t total_frames)
+    {
+        // Перемотка назад: собираем сугроб с нуля
+        if (frame_idx + 1 < this->next_frame)
+        {
+            this->reset();
+        }
         
-        for (uint32_t i = 0u; i < count_gen; ++i)
+        // Кадры, пропущенные при перемотке вперёд, проходятся
+        // без отрисовки: у каждого своя полоса по высоте
+        for (uint32_t f = this->next_frame; f <= frame_idx; ++f)
         {
-            Snowball snowball;
+            const float y_lift = this->get_y_lift(f, total_frames);
             
-            snowball.x = dist_pos_x(gen);
-            snowball.y = dist_pos_y(gen);
-            snowball.radius = this->base_radius;
+            const uint32_t count_need =
+                this->limit_snowballs *
+                    (static_cast<float>(f) / (total_frames - 1));
             
-            this->vec_snowballs.push_back(
-                std::move(snowball));
+            const uint32_t count_has =
+                this->vec_snowballs.size();
+            
+            // std::cout << std::format(
+            //     "count_need: {}\n"
+            //     "count_has: {}\n\n",
+            //     count_need, count_has);
+            // std::cout.flush();
+            
+            // Положение снежка i зависит только от seed и i
+            for (uint32_t i = count_has; i < count_need; ++i)
+            {
+                Snowball snowball;
+                
+                snowball.x =
+                    uniform_counter(this->seed, 2ull * i) * this->width;
+                snowball.y =
+                    y_lift +
+                    uniform_counter(this->seed, 2ull * i + 1) *
+                    (this->height - y_lift);
+                snowball.radius = this->base_radius;
+                
+                this->vec_snowballs.push_back(
+                    std::move(snowball));
+            }
+        }
+        
+        this->next_frame = std::max(this->next_frame, frame_idx + 1);
+    }
+    
+    void Snow_Cover::seek(
+        const uint32_t frame_idx,
+        const uint32_t total_frames)
+    {
+        if (this->engine == Snow_Cover_Engine::heightfield)
+        {
+            return;
+        }
+        
+        if (frame_idx == 0u)
+        {
+            this->reset();
+            return;
+        }
+        
+        this->add_snowballs(frame_idx - 1, total_frames);
+    }
+    
+    void Snow_Cover::save_state(Binary_Writer &writer) const
+    {
+        writer.write<uint32_t>(this->next_frame);
+        writer.write<uint64_t>(this->vec_snowballs.size());
+        
+        for (const Snowball &snowball : this->vec_snowballs)
+        {
+            writer.write<float>(snowball.x);
+            writer.write<float>(snowball.y);
+            writer.write<float>(snowball.radius);
+        }
+    }
+    
+    void Snow_Cover::load_state(Binary_Reader &reader)
+    {
+        const uint32_t next_frame = reader.read<uint32_t>();
+        const uint64_t count = reader.read<uint64_t>();
+        
+        if (count > reader.get_remaining() / (3u * sizeof(float)))
+        {
+            throw std::runtime_error(
+                "Ошибка: повреждено состояние сугроба\n");
         }
         
-        for (const Snowball &sb : this->vec_snowballs)
+        this->reset();
+        
+        this->vec_snowballs.resize(count);
+        for (Snowball &snowball : this->vec_snowballs)
         {
-            const float x = sb.x;
-            const float y = sb.y;
-            const float radius = sb.radius;
+            snowball.x = reader.read<float>();
+            snowball.y = reader.read<float>();
+            snowball.radius = reader.read<float>();
+        }
+        
+        this->next_frame = next_frame;
+    }
+    
+    void Snow_Cover::reset()
+    {
+        this->vec_snowballs.clear();
+        this->count_stamped = 0u;
+        this->layer_top_y = this->height;
+        this->next_frame = 0u;
+        
+        if (!(this->layer.empty()))
+        {
+            this->layer.setTo(cv::Scalar(0, 0, 0, 0));
+            this->layer_alpha.setTo(cv::Scalar(0));
+            this->layer_alpha_chroma.setTo(cv::Scalar(0));
+        }
+    }
+    
+    void Snow_Cover::stamp_new_snowballs()
+    {
+        const cv::Scalar color_stamp(
+            this->color[0], this->color[1], this->color[2], 255);
+        
+        const uint32_t count = this->vec_snowballs.size();
+        
+        for (uint32_t i = this->count_stamped; i < count; ++i)
+        {
+            const Snowball &sb = this->vec_snowballs[i];
             
             cv::circle(
-                frame,
-                cv::Point2f(x, y),
-                radius,
-                this->color,
+                this->layer,
+                cv::Point2f(sb.x, sb.y),
+                sb.radius,
+                color_stamp,
                 -1);
+            cv::circle(
+                this->layer_alpha,
+                cv::Point2f(sb.x, sb.y),
+                sb.radius,
+                cv::Scalar(255),
+                -1);
+            
+            // Альфа цветности пересчитывается только под снежком
+            const int cx_begin = std::max(
+                0, static_cast<int>(std::floor(sb.x - sb.radius)) / 2 - 1);
+            const int cy_begin = std::max(
+                0, static_cast<int>(std::floor(sb.y - sb.radius)) / 2 - 1);
+            const int cx_end = std::min(
+                this->layer_alpha_chroma.cols,
+                static_cast<int>(std::ceil(sb.x + sb.radius)) / 2 + 2);
+            const int cy_end = std::min(
+                this->layer_alpha_chroma.rows,
+                static_cast<int>(std::ceil(sb.y + sb.radius)) / 2 + 2);
+            
+            for (int cy = cy_begin; cy < cy_end; ++cy)
+            {
+                const uint8_t *row_0 = this->layer_alpha.ptr<uint8_t>(2 * cy);
+                const uint8_t *row_1 = this->layer_alpha.ptr<uint8_t>(
+                    std::min(2 * cy + 1, this->height - 1));
+                uint8_t *dst = this->layer_alpha_chroma.ptr<uint8_t>(cy);
+                
+                for (int cx = cx_begin; cx < cx_end; ++cx)
+                {
+                    const int x_0 = 2 * cx;
+                    const int x_1 = std::min(2 * cx + 1, this->width - 1);
+                    dst[cx] = static_cast<uint8_t>(
+                        (row_0[x_0] + row_0[x_1] +
+                         row_1[x_0] + row_1[x_1] + 2) / 4);
+                }
+            }
+            
+            const int top_y =
+                static_cast<int>(std::floor(sb.y - sb.radius)) - 1;
+            this->layer_top_y =
+                std::max(0, std::min(this->layer_top_y, top_y));
+        }
+        
+        this->count_stamped = count;
+    }
+    
+    void Snow_Cover::composite_layer(cv::Mat &frame) const
+    {
+        if (frame.channels() != 3)
+        {
+            return;
+        }
+        
+        const int rows = std::min(this->layer.rows, frame.rows);
+        const int cols = std::min(this->layer.cols, frame.cols);
+        
+        const Blend_Row_Function blend_row = get_blend_row();
+        
+        for (int y = this->layer_top_y; y < rows; ++y)
+        {
+            blend_row(
+                this->layer.ptr<uint8_t>(y),
+                frame.ptr<uint8_t>(y),
+                cols);
+        }
+    }
+    
+    void Snow_Cover::composite_layer(Frame_Yuv420 &frame) const
+    {
+        cv::Mat &plane_y = frame.get_y();
+        cv::Mat &plane_u = frame.get_u();
+        cv::Mat &plane_v = frame.get_v();
+        
+        const int rows = std::min(this->layer_alpha.rows, plane_y.rows);
+        const int cols = std::min(this->layer_alpha.cols, plane_y.cols);
+        
+        for (int y = this->layer_top_y; y < rows; ++y)
+        {
+            blend_plane_color(
+                this->layer_alpha.ptr<uint8_t>(y),
+                this->color_yuv[0],
+                plane_y.ptr<uint8_t>(y),
+                cols);
+        }
+        
+        const int rows_chroma =
+            std::min(this->layer_alpha_chroma.rows, plane_u.rows);
+        const int cols_chroma =
+            std::min(this->layer_alpha_chroma.cols, plane_u.cols);
+        
+        for (int y = this->layer_top_y / 2; y < rows_chroma; ++y)
+        {
+            const uint8_t *alpha = this->layer_alpha_chroma.ptr<uint8_t>(y);
+            
+            blend_plane_color(
+                alpha, this->color_yuv[1], plane_u.ptr<uint8_t>(y), cols_chroma);
+            blend_plane_color(
+                alpha, this->color_yuv[2], plane_v.ptr<uint8_t>(y), cols_chroma);
+        }
+    }
+    
+    void Snow_Cover::init_heightfield()
+    {
+        std::mt19937 gen(this->seed);
+        
+        // Холмы: случайные узлы через step пикселей,
+        // линейная интерполяция и несколько проходов сглаживания
+        static constexpr int step = 64;
+        const int count_knots = this->width / step + 2;
+        
+        std::uniform_real_distribution<float> dist_knot(-1.f, 1.f);
+        std::vector<float> knots(count_knots);
+        for (float &k : knots)
+        {
+            k = dist_knot(gen);
+        }
+        
+        this->profile = std::vector<float>(this->width);
+        for (int x = 0; x < this->width; ++x)
+        {
+            const int i = x / step;
+            const float t = static_cast<float>(x % step) / step;
+            this->profile[x] = knots[i] * (1.f - t) + knots[i + 1] * t;
+        }
+        
+        static constexpr int radius_smooth = 16;
+        static constexpr int count_passes = 3;
+        std::vector<float> tmp(this->width);
+        for (int pass = 0; pass < count_passes; ++pass)
+        {
+            for (int x = 0; x < this->width; ++x)
+            {
+                const int x_begin = std::max(0, x - radius_smooth);
+                const int x_end = std::min(this->width, x + radius_smooth + 1);
+                
+                float sum = 0.f;
+                for (int i = x_begin; i < x_end; ++i)
+                {
+                    sum += this->profile[i];
+                }
+                tmp[x] = sum / (x_end - x_begin);
+            }
+            this->profile.swap(tmp);
+        }
+        
+        // Холмы занимают до 15% текущей глубины сугроба
+        this->profile_amplitude = 0.15f;
+        
+        this->column_top = std::vector<int>(this->width, this->height);
+        
+        // Текстура шума: цвет сугроба с мелкими пятнами,
+        // размытыми с переносом через край, чтобы тайл был бесшовным
+        static constexpr int size_tile = 64;
+        std::uniform_int_distribution<int> dist_noise(-12, 12);
+        
+        cv::Mat noise(size_tile, size_tile, CV_32FC1);
+        for (int y = 0; y < size_tile; ++y)
+        {
+            for (int x = 0; x < size_tile; ++x)
+            {
+                noise.at<float>(y, x) = dist_noise(gen);
+            }
+        }
+        
+        cv::Mat noise_blur(size_tile, size_tile, CV_32FC1);
+        for (int y = 0; y < size_tile; ++y)
+        {
+            for (int x = 0; x < size_tile; ++x)
+            {
+                float sum = 0.f;
+                for (int dy = -1; dy <= 1; ++dy)
+                {
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        sum += noise.at<float>(
+                            (y + dy + size_tile) % size_tile,
+                            (x + dx + size_tile) % size_tile);
+                    }
+                }
+                noise_blur.at<float>(y, x) = sum / 9.f;
+            }
+        }
+        
+        this->noise_tile = cv::Mat(size_tile, size_tile, CV_8UC3);
+        for (int y = 0; y < size_tile; ++y)
+        {
+            for (int x = 0; x < size_tile; ++x)
+            {
+                const float n = noise_blur.at<float>(y, x);
+                cv::Vec3b &pixel = this->noise_tile.at<cv::Vec3b>(y, x);
+                for (int c = 0; c < 3; ++c)
+                {
+                    pixel[c] = cv::saturate_cast<uchar>(this->color[c] + n);
+                }
+            }
+        }
+        
+        // Для кадра YUV 4:2:0: цветность — среднее по блокам 2 x 2,
+        // тайл чётного размера остаётся бесшовным
+        const int size_tile_chroma = size_tile / 2;
+        
+        this->noise_tile_y = cv::Mat(size_tile, size_tile, CV_8UC1);
+        this->noise_tile_u =
+            cv::Mat(size_tile_chroma, size_tile_chroma, CV_8UC1);
+        this->noise_tile_v =
+            cv::Mat(size_tile_chroma, size_tile_chroma, CV_8UC1);
+        
+        cv::Mat tile_yuv(size_tile, size_tile, CV_32FC3);
+        for (int y = 0; y < size_tile; ++y)
+        {
+            for (int x = 0; x < size_tile; ++x)
+            {
+                const cv::Vec3b &pixel = this->noise_tile.at<cv::Vec3b>(y, x);
+                const cv::Vec3f yuv = bgr_to_yuv(pixel[0], pixel[1], pixel[2]);
+                
+                tile_yuv.at<cv::Vec3f>(y, x) = yuv;
+                this->noise_tile_y.at<uint8_t>(y, x) =
+                    cv::saturate_cast<uchar>(yuv[0]);
+            }
+        }
+        
+        for (int y = 0; y < size_tile_chroma; ++y)
+        {
+            for (int x = 0; x < size_tile_chroma; ++x)
+            {
+                const cv::Vec3f sum =
+                    tile_yuv.at<cv::Vec3f>(2 * y, 2 * x) +
+                    tile_yuv.at<cv::Vec3f>(2 * y, 2 * x + 1) +
+                    tile_yuv.at<cv::Vec3f>(2 * y + 1, 2 * x) +
+                    tile_yuv.at<cv::Vec3f>(2 * y + 1, 2 * x + 1);
+                
+                this->noise_tile_u.at<uint8_t>(y, x) =
+                    cv::saturate_cast<uchar>(sum[1] / 4.f);
+                this->noise_tile_v.at<uint8_t>(y, x) =
+                    cv::saturate_cast<uchar>(sum[2] / 4.f);
+            }
+        }
+    }
+    
+    void Snow_Cover::render_heightfield(cv::Mat &frame)
+    {
+        if (frame.channels() != 3)
+        {
+            return;
+        }
+        
+        const int rows = std::min(this->height, frame.rows);
+        const int cols = std::min(this->width, frame.cols);
+        
+        const int min_top = this->update_column_top(rows, cols);
+        
+        // Каждый столбец — один вертикальный отрезок [top, rows).
+        // Отрезки закрашиваются построчно, чтобы писать в кадр
+        // подряд: строка y покрывает столбцы с top <= y
+        const int size_tile = this->noise_tile.rows;
+        
+        for (int y = min_top; y < rows; ++y)
+        {
+            const cv::Vec3b *tile_row =
+                this->noise_tile.ptr<cv::Vec3b>(y % size_tile);
+            cv::Vec3b *dst = frame.ptr<cv::Vec3b>(y);
+            
+            for (int x = 0; x < cols; ++x)
+            {
+                if (this->column_top[x] <= y)
+                {
+                    dst[x] = tile_row[x % size_tile];
+                }
+            }
+        }
+    }
+    
+    void Snow_Cover::render_heightfield(Frame_Yuv420 &frame)
+    {
+        cv::Mat &plane_y = frame.get_y();
+        cv::Mat &plane_u = frame.get_u();
+        cv::Mat &plane_v = frame.get_v();
+        
+        const int rows = std::min(this->height, plane_y.rows);
+        const int cols = std::min(this->width, plane_y.cols);
+        
+        const int min_top = this->update_column_top(rows, cols);
+        
+        const int size_tile = this->noise_tile_y.rows;
+        
+        for (int y = min_top; y < rows; ++y)
+        {
+            const uint8_t *tile_row =
+                this->noise_tile_y.ptr<uint8_t>(y % size_tile);
+            uint8_t *dst = plane_y.ptr<uint8_t>(y);
+            
+            for (int x = 0; x < cols; ++x)
+            {
+                if (this->column_top[x] <= y)
+                {
+                    dst[x] = tile_row[x % size_tile];
+                }
+            }
+        }
+        
+        // Блок цветности закрашивается, если снег покрывает
+        // его левый верхний пиксель
+        const int size_tile_chroma = this->noise_tile_u.rows;
+        const int rows_chroma = rows / 2;
+        const int cols_chroma = cols / 2;
+        
+        for (int y = min_top / 2; y < rows_chroma; ++y)
+        {
+            const uint8_t *tile_u =
+                this->noise_tile_u.ptr<uint8_t>(y % size_tile_chroma);
+            const uint8_t *tile_v =
+                this->noise_tile_v.ptr<uint8_t>(y % size_tile_chroma);
+            uint8_t *dst_u = plane_u.ptr<uint8_t>(y);
+            uint8_t *dst_v = plane_v.ptr<uint8_t>(y);
+            
+            for (int x = 0; x < cols_chroma; ++x)
+            {
+                if (this->column_top[2 * x] <= 2 * y)
+                {
+                    dst_u[x] = tile_u[x % size_tile_chroma];
+                    dst_v[x] = tile_v[x % size_tile_chroma];
+                }
+            }
+        }
+    }
+    
+    int Snow_Cover::update_column_top(
+        const int rows,
+        const int cols)
+    {
+        // Поднимаем поверхность по тому же расписанию,
+        // что и полосу снежков: от min_y_lift к max_y_lift
+        const float depth = this->height - this->current_y_lift;
+        const float amplitude = depth * this->profile_amplitude;
+        
+        int min_top = rows;
+        for (int x = 0; x < cols; ++x)
+        {
+            const float top =
+                this->current_y_lift - amplitude * this->profile[x];
+            const int top_clamped = std::max(
+                0, std::min(rows, static_cast<int>(top)));
+            
+            this->column_top[x] = top_clamped;
+            min_top = std::min(min_top, top_clamped);
         }
         
+        return min_top;
     }
     
 }
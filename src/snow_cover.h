@@ -9,6 +9,9 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "frame_yuv420.h"
+#include "binary_io.h"
+
 namespace InSomnia
 {
     struct Snowball
@@ -18,18 +21,72 @@ namespace InSomnia
         float radius;
     };
     
+    enum class Snow_Cover_Engine
+    {
+        snowballs,  // накопление одинаковых снежков
+        heightfield // карта высот: глубина снега по столбцам
+    };
+    
     class Snow_Cover
     {
     public:
         Snow_Cover();
         
+        // density_per_megapixel — снежков на миллион пикселей кадра
+        // к концу видео, radius_scale — радиус снежка в долях диагонали.
+        // Число снежков и их положение следуют за размером кадра.
+        // seed задаёт положения снежков и рельеф сугроба
+        Snow_Cover(
+            const int width,
+            const int height,
+            const float density_per_megapixel,
+            const float radius_scale,
+            const cv::Scalar &color,
+            const Snow_Cover_Engine engine,
+            const uint64_t seed);
+        
+        // Кадры можно рисовать в любом порядке: снежок i всегда
+        // получает одно и то же положение, при перемотке назад
+        // сугроб собирается заново
         void render(
             const uint32_t frame_idx,
             const uint32_t total_frames,
             cv::Mat &frame);
         
+        void render(
+            const uint32_t frame_idx,
+            const uint32_t total_frames,
+            Frame_Yuv420 &frame);
+        
+        // Снежки всех кадров до frame_idx, без отрисовки
+        void seek(
+            const uint32_t frame_idx,
+            const uint32_t total_frames);
+        
+        // Снежки и номер кадра. Слой не сохраняется:
+        // после загрузки снежки заново рисуются в него
+        void save_state(Binary_Writer &writer) const;
+        
+        void load_state(Binary_Reader &reader);
+        
     private:
+        Snow_Cover_Engine engine;
+        uint64_t seed;
+        
         std::vector<Snowball> vec_snowballs;
+        uint32_t next_frame; // Снежки добавлены по кадр next_frame - 1
+        
+        // Накопленный сугроб (BGRA): каждый снежок рисуется в него
+        // один раз, а в кадр переносится только готовый слой
+        cv::Mat layer;
+        uint32_t count_stamped;
+        int layer_top_y; // Верхняя занятая строка слоя
+        
+        // Альфа слоя для кадра YUV 4:2:0: отдельной плоскостью
+        // и средним по блокам 2 x 2 для цветности
+        cv::Mat layer_alpha;
+        cv::Mat layer_alpha_chroma;
+        cv::Vec3b color_yuv;
         
         int width;
         int height;
@@ -43,6 +100,49 @@ namespace InSomnia
         float max_y_lift;
         float min_y_lift;
         float current_y_lift;
+        
+        // Карта высот: сглаженный профиль поверхности в долях
+        // глубины, верхняя строка снега по столбцам
+        // и маленькая текстура шума, которая повторяется по кадру
+        std::vector<float> profile;
+        std::vector<int> column_top;
+        float profile_amplitude;
+        cv::Mat noise_tile;
+        
+        // Та же текстура в Y и в U, V половинного размера
+        cv::Mat noise_tile_y;
+        cv::Mat noise_tile_u;
+        cv::Mat noise_tile_v;
+        
+        float get_y_lift(
+            const uint32_t frame_idx,
+            const uint32_t total_frames) const;
+        
+        // Добавляет снежки всех кадров по frame_idx включительно
+        void add_snowballs(
+            const uint32_t frame_idx,
+            const uint32_t total_frames);
+        
+        void stamp_new_snowballs();
+        
+        // Пустой сугроб перед кадром 0
+        void reset();
+        
+        void init_heightfield();
+        
+        void render_heightfield(cv::Mat &frame);
+        
+        void render_heightfield(Frame_Yuv420 &frame);
+        
+        // Верхние строки снега по столбцам для текущей глубины,
+        // возвращает самую верхнюю
+        int update_column_top(
+            const int rows,
+            const int cols);
+        
+        void composite_layer(cv::Mat &frame) const;
+        
+        void composite_layer(Frame_Yuv420 &frame) const;
     };
 }
 
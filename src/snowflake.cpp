@@ -1,158 +1,430 @@
 #include "snowflake.h"
 
+#include <sstream>
+
 namespace InSomnia
 {
-    Snowflake::Snowflake()
+    // Масштабы снежинок (доля высоты кадра)
+    static constexpr float scale_global = 0.7f;
+    static constexpr float scale_min = 0.01f * scale_global;
+    static constexpr float scale_max = 0.16f * scale_global;
+    
+    // Корзины масштаба и число углов в атласе поворотов
+    static constexpr uint32_t count_buckets = 16u;
+    static constexpr uint32_t count_angles = 64u;
+    
+    // Шаг ключевых кадров для перемотки
+    static constexpr uint32_t keyframe_interval = 256u;
+    
+    Snowflake_Particles::Snowflake_Particles()
     {
-        static constexpr double nan =
-            std::numeric_limits<double>::signaling_NaN();
         
-        this->need_remove = false;
+    }
+    
+    void Snowflake_Particles::reserve(const uint32_t capacity)
+    {
+        this->x.reserve(capacity);
+        this->y.reserve(capacity);
+        this->vx.reserve(capacity);
+        this->vy.reserve(capacity);
+        this->rotation.reserve(capacity);
+        this->rotation_speed.reserve(capacity);
+        this->half_height.reserve(capacity);
+        this->sprite.reserve(capacity);
+        this->is_out.reserve(capacity);
+    }
+    
+    uint32_t Snowflake_Particles::size() const
+    {
+        return this->x.size();
+    }
+    
+    void Snowflake_Particles::save_state(Binary_Writer &writer) const
+    {
+        std::vector<uint16_t> idx_bucket(this->size());
+        std::vector<uint16_t> idx_angle(this->size());
+        for (uint32_t i = 0u; i < this->size(); ++i)
+        {
+            idx_bucket[i] = this->sprite[i].idx_bucket;
+            idx_angle[i] = this->sprite[i].idx_angle;
+        }
         
-        this->scale = nan;
-        this->rotation = nan;
-        this->rotation_speed = nan;
+        writer.write_vector(this->x);
+        writer.write_vector(this->y);
+        writer.write_vector(this->vx);
+        writer.write_vector(this->vy);
+        writer.write_vector(this->rotation);
+        writer.write_vector(this->rotation_speed);
+        writer.write_vector(this->half_height);
+        writer.write_vector(idx_bucket);
+        writer.write_vector(idx_angle);
+        writer.write_vector(this->is_out);
     }
     
-    Snowflake::Snowflake(
+    void Snowflake_Particles::load_state(Binary_Reader &reader)
+    {
+        // assign сохраняет выделенную reserve память
+        const auto load = [&reader](auto &values)
+        {
+            using T = typename std::decay_t<decltype(values)>::value_type;
+            const std::vector<T> loaded = reader.read_vector<T>();
+            values.assign(loaded.begin(), loaded.end());
+        };
+        
+        load(this->x);
+        load(this->y);
+        load(this->vx);
+        load(this->vy);
+        load(this->rotation);
+        load(this->rotation_speed);
+        load(this->half_height);
+        
+        const std::vector<uint16_t> idx_bucket = reader.read_vector<uint16_t>();
+        const std::vector<uint16_t> idx_angle = reader.read_vector<uint16_t>();
+        
+        load(this->is_out);
+        
+        const uint32_t count = this->x.size();
+        if (this->y.size() != count || this->vx.size() != count ||
+            this->vy.size() != count || this->rotation.size() != count ||
+            this->rotation_speed.size() != count ||
+            this->half_height.size() != count ||
+            idx_bucket.size() != count || idx_angle.size() != count ||
+            this->is_out.size() != count)
+        {
+            throw std::runtime_error(
+                "Ошибка: повреждено состояние снежинок\n");
+        }
+        
+        this->sprite.resize(count);
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            this->sprite[i] = { idx_bucket[i], idx_angle[i] };
+        }
+    }
+    
+    void Snowflake_Particles::spawn(
         const uint32_t width,
         const uint32_t height,
-        const cv::Mat &original_img)
+        const Snowflake_Sprite_Cache &cache,
+        std::mt19937 &gen)
     {
-        static constexpr float scale_global = 0.7;
-        
-        this->need_remove = false;
-        
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        
-        static std::uniform_real_distribution<float>
+        const uint32_t idx = this->size();
+        const uint32_t count = idx + 1;
+        
+        this->x.resize(count);
+        this->y.resize(count);
+        this->vx.resize(count);
+        this->vy.resize(count);
+        this->rotation.resize(count);
+        this->rotation_speed.resize(count);
+        this->half_height.resize(count);
+        this->sprite.resize(count);
+        this->is_out.resize(count);
+        
+        this->init(idx, width, height, cache, gen);
+    }
+    
+    void Snowflake_Particles::init(
+        const uint32_t idx,
+        const uint32_t width,
+        const uint32_t height,
+        const Snowflake_Sprite_Cache &cache,
+        std::mt19937 &gen)
+    {
+        std::uniform_real_distribution<float>
             speed_y(0.5f, 4.0f);
-        static std::uniform_real_distribution<float>
+        std::uniform_real_distribution<float>
             speed_x(-0.5f, 0.5f);
         
-        this->velocity.y = speed_y(gen);
-        this->velocity.x = speed_x(gen);
+        this->vy[idx] = speed_y(gen);
+        this->vx[idx] = speed_x(gen);
         
-        static std::uniform_real_distribution<float>
+        std::uniform_real_distribution<float>
             small_dist(0.01f, 0.05f);  // мелкие
-        static std::uniform_real_distribution<float>
+        std::uniform_real_distribution<float>
             middle_dist(0.05f, 0.12f);  // средние
-        static std::uniform_real_distribution<float>
+        std::uniform_real_distribution<float>
             large_dist(0.12f, 0.16f);  // большие
-        static std::uniform_real_distribution<float>
+        std::uniform_real_distribution<float>
             chance(0.0f, 1.0f);         // шанс
         
         const float ch = chance(gen);
         
+        float scale;
+        
         // 0.98 -> 1.0
         if (ch > 0.98f)
         {
-            this->scale = large_dist(gen);
+            scale = large_dist(gen);
         }
         // 0.2 -> 0.98
         else if (ch > 0.2f)
         {
-            this->scale = middle_dist(gen);
+            scale = middle_dist(gen);
         }
         // 0.0 -> 0.2
         else
         {
-            this->scale = small_dist(gen);
+            scale = small_dist(gen);
         }
         
-        this->scale = this->scale * scale_global;
+        scale = scale * scale_global;
         
-        const int target_height =
-            static_cast<int>(height * this->scale);
-        const int target_width = static_cast<int>(
-            original_img.cols * (
-                (float)target_height / original_img.rows));
+        // Вместо cv::resize берём готовую корзину масштаба
+        const uint16_t idx_bucket =
+            static_cast<uint16_t>(cache.scale_to_bucket(scale));
         
-        cv::Mat resized;
-        cv::resize(
-            original_img,
-            resized,
-            cv::Size(target_width, target_height),
-            0,
-            0,
-            cv::INTER_AREA);
+        const Sprite &sprite_base = cache.get_sprite({ idx_bucket, 0u });
+        const float target_width = sprite_base.get_width();
+        const float target_height = sprite_base.get_height();
         
         const float diagonal =
             std::sqrt(target_width * target_width +
                       target_height * target_height);
         
-        static std::uniform_int_distribution<int>
+        std::uniform_int_distribution<int>
             x_dist(0, width - 1);
-        this->pos.x = static_cast<float>(x_dist(gen));
-        this->pos.y = -diagonal;
+        this->x[idx] = static_cast<float>(x_dist(gen));
+        this->y[idx] = -diagonal;
+        this->half_height[idx] = target_height / 2.0f;
         
-        this->base_img = resized.clone();
-        static std::uniform_real_distribution<float>
+        std::uniform_real_distribution<float>
             rotation_dist(0.f, 360.f);
-        this->rotation = static_cast<float>(rotation_dist(gen));
-        static std::uniform_real_distribution<float>
+        this->rotation[idx] = static_cast<float>(rotation_dist(gen));
+        std::uniform_real_distribution<float>
             rotation_speed_dist(-2.f, 2.f);
-        this->rotation_speed =
+        this->rotation_speed[idx] =
             static_cast<float>(rotation_speed_dist(gen));
         
+        this->sprite[idx] = cache.make_handle(idx_bucket, this->rotation[idx]);
+        this->is_out[idx] = 0u;
     }
     
-    void Snowflake::move()
+    void Snowflake_Particles::integrate()
     {
-        this->pos.x += this->velocity.x;
-        this->pos.y += this->velocity.y;
-        this->rotation += this->rotation_speed;
+        const uint32_t count = this->size();
+        
+        float *x = this->x.data();
+        float *y = this->y.data();
+        const float *vx = this->vx.data();
+        const float *vy = this->vy.data();
+        float *rotation = this->rotation.data();
+        const float *rotation_speed = this->rotation_speed.data();
+        
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            x[i] += vx[i];
+            y[i] += vy[i];
+        }
+        
+        // |rotation_speed| < 360, поэтому хватает одного переноса;
+        // перенос без ветвлений, чтобы цикл векторизовался
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            const float r = rotation[i] + rotation_speed[i];
+            const float wrap =
+                static_cast<float>(r < 0.f) - static_cast<float>(r >= 360.f);
+            rotation[i] = r + 360.f * wrap;
+        }
     }
     
-    void Snowflake::rotate()
+    void Snowflake_Particles::update_sprites(
+        const Snowflake_Sprite_Cache &cache)
     {
-        cv::Point2f center(
-            this->base_img.cols / 2.0f,
-            this->base_img.rows / 2.0f);
-        
-        cv::Mat rotation_matrix =
-            cv::getRotationMatrix2D(center, this->rotation, 1.0);
+        const uint32_t count = this->size();
+        const int count_angles = cache.get_count_angles();
+        const float angle_to_index = count_angles / 360.f;
         
-        // cv::Mat rotated_img;
+        const float *rotation = this->rotation.data();
+        Sprite_Handle *sprite = this->sprite.data();
         
-        cv::warpAffine(
-            this->base_img,
-            this->rotated_img,
-            rotation_matrix, 
-            this->base_img.size(),
-            cv::INTER_LINEAR,
-            cv::BORDER_CONSTANT,
-            cv::Scalar(0,0,0,0));
+        // Угол уже в [0, 360): ближайший индекс без fmod и lround
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            int idx_angle =
+                static_cast<int>(rotation[i] * angle_to_index + 0.5f);
+            idx_angle =
+                idx_angle >= count_angles ? idx_angle - count_angles : idx_angle;
+            sprite[i].idx_angle = static_cast<uint16_t>(idx_angle);
+        }
+    }
+    
+    void Snowflake_Particles::draw_to_frame(
+        const Snowflake_Sprite_Cache &cache,
+        cv::Mat &frame) const
+    {
+        const uint32_t count = this->size();
+        if (count == 0u)
+        {
+            return;
+        }
         
-        // return rotated_img;
+        // Кадр режется на горизонтальные полосы, каждая полоса
+        // рисует пересекающие её снежинки в том же порядке,
+        // что и последовательный проход. Потоки пишут в разные
+        // строки, поэтому результат побитово совпадает
+        const int count_bands = std::min(
+            frame.rows,
+            std::max(1, cv::getNumThreads() * 4));
+        
+        cv::parallel_for_(
+            cv::Range(0, frame.rows),
+            [this, &cache, &frame, count](const cv::Range &band)
+            {
+                // Запас в строку на округление левого верхнего угла
+                const float band_top = band.start - 1.f;
+                const float band_bottom = band.end + 1.f;
+                
+                for (uint32_t i = 0u; i < count; ++i)
+                {
+                    const float y = this->y[i];
+                    const float half_height = this->half_height[i];
+                    
+                    if (y + half_height < band_top ||
+                        y - half_height > band_bottom)
+                    {
+                        continue;
+                    }
+                    
+                    draw_sprite_to_frame(
+                        cache.get_sprite(this->sprite[i]),
+                        this->x[i],
+                        y,
+                        band.start,
+                        band.end,
+                        frame);
+                }
+            },
+            count_bands);
     }
     
-    void Snowflake::draw_to_frame(cv::Mat &frame)
+    void Snowflake_Particles::draw_to_frame(
+        const Snowflake_Sprite_Cache &cache,
+        Frame_Yuv420 &frame) const
     {
-        draw_figure_to_frame(
-            this->rotated_img,
-            this->pos.x,
-            this->pos.y,
-            frame);
+        const uint32_t count = this->size();
+        if (count == 0u)
+        {
+            return;
+        }
+        
+        // Полосы режутся по строкам цветности: у каждой полосы
+        // свои строки и яркости, и цветности
+        const int rows_chroma = frame.get_height() / 2;
+        const int count_bands = std::min(
+            rows_chroma,
+            std::max(1, cv::getNumThreads() * 4));
+        
+        cv::parallel_for_(
+            cv::Range(0, rows_chroma),
+            [this, &cache, &frame, count](const cv::Range &band)
+            {
+                const int row_begin = 2 * band.start;
+                const int row_end = 2 * band.end;
+                
+                // Запас на округление угла и цветность над ним
+                const float band_top = row_begin - 2.f;
+                const float band_bottom = row_end + 2.f;
+                
+                for (uint32_t i = 0u; i < count; ++i)
+                {
+                    const float y = this->y[i];
+                    const float half_height = this->half_height[i];
+                    
+                    if (y + half_height < band_top ||
+                        y - half_height > band_bottom)
+                    {
+                        continue;
+                    }
+                    
+                    draw_sprite_to_frame(
+                        cache.get_sprite_yuv(this->sprite[i]),
+                        this->x[i],
+                        y,
+                        row_begin,
+                        row_end,
+                        frame);
+                }
+            },
+            count_bands);
     }
     
-    bool Snowflake::is_out_frame(const uint32_t height)
+    uint32_t Snowflake_Particles::cull(const uint32_t height)
     {
-        const bool is_out =
-            this->pos.y - this->rotated_img.rows / 2.0f > height;
+        const uint32_t count = this->size();
+        const float bottom = static_cast<float>(height);
+        
+        const float *y = this->y.data();
+        const float *half_height = this->half_height.data();
+        uint8_t *is_out = this->is_out.data();
+        
+        uint32_t count_out = 0u;
         
-        return is_out;
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            const uint8_t out = y[i] - half_height[i] > bottom ? 1u : 0u;
+            is_out[i] = out;
+            count_out += out;
+        }
+        
+        return count_out;
     }
     
-    void Snowflake::set_remove()
+    void Snowflake_Particles::recycle(
+        const uint32_t width,
+        const uint32_t height,
+        const Snowflake_Sprite_Cache &cache,
+        std::mt19937 &gen)
     {
-        this->need_remove = true;
+        const uint32_t count = this->size();
+        
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            if (this->is_out[i] != 0u)
+            {
+                this->init(i, width, height, cache, gen);
+            }
+        }
     }
     
-    bool Snowflake::get_remove() const
+    void Snowflake_Particles::remove_culled()
     {
-        return this->need_remove;
+        const uint32_t count = this->size();
+        
+        // Устойчивое сжатие: оставшиеся сдвигаются вперёд по порядку
+        uint32_t idx_dst = 0u;
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            if (this->is_out[i] != 0u)
+            {
+                continue;
+            }
+            
+            if (idx_dst != i)
+            {
+                this->x[idx_dst] = this->x[i];
+                this->y[idx_dst] = this->y[i];
+                this->vx[idx_dst] = this->vx[i];
+                this->vy[idx_dst] = this->vy[i];
+                this->rotation[idx_dst] = this->rotation[i];
+                this->rotation_speed[idx_dst] = this->rotation_speed[i];
+                this->half_height[idx_dst] = this->half_height[i];
+                this->sprite[idx_dst] = this->sprite[i];
+                this->is_out[idx_dst] = 0u;
+            }
+            ++idx_dst;
+        }
+        
+        this->x.resize(idx_dst);
+        this->y.resize(idx_dst);
+        this->vx.resize(idx_dst);
+        this->vy.resize(idx_dst);
+        this->rotation.resize(idx_dst);
+        this->rotation_speed.resize(idx_dst);
+        this->half_height.resize(idx_dst);
+        this->sprite.resize(idx_dst);
+        this->is_out.resize(idx_dst);
     }
     
     // void Snowflake::generate_snow(
@@ -313,32 +585,31 @@ namespace InSomnia
     Snowfall::Snowfall()
     {
         this->time_create_snowflake = 0u;
-        this->is_active = false;
-        this->idx_schedule = -1;
+        this->state.is_active = false;
+        this->state.idx_schedule = -1;
+        this->next_frame = 0u;
+        this->keyframes.push_back(this->state);
     }
     
     Snowfall::Snowfall(
         const std::string &path_file,
         const std::vector<Interval_Snow> &schedule,
         const int fps,
-        const uint32_t total_frames)
+        const uint32_t total_frames,
+        const int height,
+        const uint64_t seed)
     {
         // const uint32_t total_frames = vec_frames.size();
         
-        const cv::Mat snow_img =
-            cv::imread(path_file, cv::IMREAD_UNCHANGED);
-        
-        if (snow_img.empty())
-        {
-            throw std::runtime_error(
-                "Ошибка: не удалось загрузить файл snow.png\n");
-        }
-        
-        const cv::Mat snow_img_rgba =
-            InSomnia::convert_to_rgba(snow_img);
-        
-        this->img_snowflake =
-            InSomnia::clear_alpha(snow_img_rgba);
+        // Атласы поворотов по корзинам масштаба: один кеш
+        // на все снегопады с тем же файлом и высотой кадра
+        this->sprite_cache = Snowflake_Sprite_Cache::get_shared(
+            path_file,
+            height,
+            scale_min,
+            scale_max,
+            count_buckets,
+            count_angles);
         
         if (schedule.empty() == true)
         {
@@ -390,9 +661,23 @@ namespace InSomnia
         
         this->time_create_snowflake = 3u;
         
-        this->is_active = false;
+        this->state.gen.seed(seed);
+        
+        this->state.is_active = false;
+        
+        this->state.idx_schedule = 0u;
+        
+        // Память под самый плотный интервал выделяется один раз
+        uint32_t max_snowflakes = 0u;
+        for (const Interval_Snow &interval : this->schedule)
+        {
+            max_snowflakes =
+                std::max(max_snowflakes, interval.count_snowflakes);
+        }
+        this->state.snowflakes.reserve(max_snowflakes);
         
-        this->idx_schedule = 0u;
+        this->next_frame = 0u;
+        this->keyframes.push_back(this->state);
     }
     
     void Snowfall::render(
@@ -401,83 +686,160 @@ namespace InSomnia
         const int height,
         cv::Mat &frame)
     {
+        this->seek(frame_idx, width, height);
+        
+        this->simulate_frame(frame_idx, width, height);
+        
+        // Рисуем после перезапуска: ушедшие за нижний край
+        // и новые снежинки над верхним краем всё равно не видны,
+        // кадр совпадает с рисованием до перезапуска
+        this->state.snowflakes.draw_to_frame(*(this->sprite_cache), frame);
+    }
+    
+    void Snowfall::render(
+        const uint32_t frame_idx,
+        const int width,
+        const int height,
+        Frame_Yuv420 &frame)
+    {
+        this->seek(frame_idx, width, height);
+        
+        this->simulate_frame(frame_idx, width, height);
+        
+        this->state.snowflakes.draw_to_frame(*(this->sprite_cache), frame);
+    }
+    
+    void Snowfall::seek(
+        const uint32_t frame_idx,
+        const int width,
+        const int height)
+    {
+        if (frame_idx == this->next_frame)
+        {
+            return;
+        }
+        
+        // Назад или далеко вперёд — с ближайшего ключевого кадра
+        const uint32_t idx_keyframe = std::min<uint32_t>(
+            frame_idx / keyframe_interval,
+            this->keyframes.size() - 1);
+        const uint32_t frame_keyframe = idx_keyframe * keyframe_interval;
+        
+        if (frame_idx < this->next_frame ||
+            frame_keyframe > this->next_frame)
+        {
+            this->state = this->keyframes[idx_keyframe];
+            this->next_frame = frame_keyframe;
+        }
+        
+        while (this->next_frame < frame_idx)
+        {
+            this->simulate_frame(this->next_frame, width, height);
+        }
+    }
+    
+    void Snowfall::save_state(Binary_Writer &writer) const
+    {
+        std::ostringstream stream_gen;
+        stream_gen << this->state.gen;
+        
+        writer.write<uint32_t>(this->next_frame);
+        writer.write<uint8_t>(this->state.is_active ? 1u : 0u);
+        writer.write<uint32_t>(this->state.idx_schedule);
+        writer.write_string(stream_gen.str());
+        
+        this->state.snowflakes.save_state(writer);
+    }
+    
+    void Snowfall::load_state(Binary_Reader &reader)
+    {
+        this->next_frame = reader.read<uint32_t>();
+        this->state.is_active = reader.read<uint8_t>() != 0u;
+        this->state.idx_schedule = reader.read<uint32_t>();
+        
+        std::istringstream stream_gen(reader.read_string());
+        stream_gen >> this->state.gen;
+        if (!stream_gen)
+        {
+            throw std::runtime_error(
+                "Ошибка: повреждено состояние генератора снегопада\n");
+        }
+        
+        this->state.snowflakes.load_state(reader);
+    }
+    
+    void Snowfall::simulate_frame(
+        const uint32_t frame_idx,
+        const int width,
+        const int height)
+    {
+        Snowfall_State &st = this->state;
+        
         uint32_t num_snowflakes = 0u;
         
-        if (this->idx_schedule < this->schedule.size())
+        if (st.idx_schedule < this->schedule.size())
         {
-            if (frame_idx > this->schedule[this->idx_schedule].idx_frame_finish)
+            if (frame_idx > this->schedule[st.idx_schedule].idx_frame_finish)
             {
-                ++idx_schedule;
+                ++(st.idx_schedule);
             }
         }
         
-        if (this->idx_schedule >= this->schedule.size())
+        if (st.idx_schedule >= this->schedule.size())
         {
-            this->is_active = false;
+            st.is_active = false;
             num_snowflakes = 0u;
         }
         else
         {
             const Interval_Snow &interval =
-                this->schedule[this->idx_schedule];
+                this->schedule[st.idx_schedule];
             
             if (interval.idx_frame_start == frame_idx)
             {
-                this->is_active = true;
+                st.is_active = true;
             }
             if (interval.idx_frame_finish == frame_idx)
             {
-                this->is_active = false;
+                st.is_active = false;
             }
             
             num_snowflakes = interval.count_snowflakes;
         }
         
-        for (InSomnia::Snowflake &sf : this->snowflakes)
+        const Snowflake_Sprite_Cache &cache = *(this->sprite_cache);
+        
+        st.snowflakes.integrate();
+        
+        st.snowflakes.update_sprites(cache);
+        
+        // Перезапуск снежинок при выходе за нижнюю границу
+        if (st.snowflakes.cull(height) > 0u)
         {
-            sf.move();
-            
-            sf.rotate();
-            
-            sf.draw_to_frame(frame);
-            
-            // Перезапуск снежинки при выходе за нижнюю границу
-            if (sf.is_out_frame(height))
+            if (st.is_active == true)
             {
-                if (is_active == true)
-                {
-                    sf = Snowflake(
-                        width, height, this->img_snowflake);
-                }
-                else if (this->snowflakes.size() > 0)
-                {
-                    sf.set_remove();
-                }
+                st.snowflakes.recycle(width, height, cache, st.gen);
+            }
+            else
+            {
+                st.snowflakes.remove_culled();
             }
         }
         
-        if (this->is_active == false &&
-            this->snowflakes.size() > 0)
+        if (st.snowflakes.size() < num_snowflakes &&
+            frame_idx % time_create_snowflake == 0 &&
+            st.is_active == true)
         {
-            const std::vector<InSomnia::Snowflake>::iterator
-            it_new_end = std::remove_if(
-                this->snowflakes.begin(),
-                this->snowflakes.end(),
-            [](const Snowflake &s) -> bool
-            {
-                return s.get_remove();
-            });
-            
-            this->snowflakes.erase(
-                it_new_end, this->snowflakes.end());
+            st.snowflakes.spawn(width, height, cache, st.gen);
         }
         
-        if (this->snowflakes.size() < num_snowflakes &&
-            frame_idx % time_create_snowflake == 0 &&
-            this->is_active == true)
+        this->next_frame = frame_idx + 1;
+        
+        // Запоминаем ключевой кадр, когда проходим его впервые
+        if (this->next_frame % keyframe_interval == 0u &&
+            this->next_frame / keyframe_interval == this->keyframes.size())
         {
-            this->snowflakes.emplace_back(
-                width, height, this->img_snowflake);
+            this->keyframes.push_back(st);
         }
         
         // if ((frame_idx + 1) % fps == 0)
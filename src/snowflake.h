@@ -9,6 +9,10 @@
 #include <opencv2/opencv.hpp>
 
 #include "toolbox.h"
+#include "sprite.h"
+#include "binary_io.h"
+#include "frame_yuv420.h"
+#include "snowflake_cache.h"
 
 namespace InSomnia
 {
@@ -22,49 +26,92 @@ namespace InSomnia
         uint32_t idx_frame_finish;
     };
     
-    class Snowflake
+    // Снежинки в виде структуры массивов: движение, выбор спрайта
+    // и отсечение идут отдельными проходами по непрерывным массивам
+    // float, которые компилятор векторизует
+    class Snowflake_Particles
     {
     public:
-        Snowflake();
+        Snowflake_Particles();
         
-        Snowflake(
+        void reserve(const uint32_t capacity);
+        
+        uint32_t size() const;
+        
+        // Новая снежинка над верхней границей кадра
+        void spawn(
             const uint32_t width,
             const uint32_t height,
-            const cv::Mat &original_img);
+            const Snowflake_Sprite_Cache &cache,
+            std::mt19937 &gen);
+        
+        // Сдвиг и поворот всех снежинок на один кадр
+        void integrate();
         
-        void move();
+        // Готовый спрайт атласа для текущего угла каждой снежинки
+        void update_sprites(const Snowflake_Sprite_Cache &cache);
         
-        void rotate();
-                
-        void draw_to_frame(cv::Mat &frame);
+        // Рисует снежинки в порядке появления, параллельно
+        // по горизонтальным полосам кадра
+        void draw_to_frame(
+            const Snowflake_Sprite_Cache &cache,
+            cv::Mat &frame) const;
         
-        bool is_out_frame(const uint32_t height);
+        // То же в кадр YUV 4:2:0: полосы по чётным строкам
+        void draw_to_frame(
+            const Snowflake_Sprite_Cache &cache,
+            Frame_Yuv420 &frame) const;
         
-        void set_remove();
+        // Отмечает снежинки за нижней границей, возвращает их число
+        uint32_t cull(const uint32_t height);
         
-        bool get_remove() const;
+        // Отмеченные снежинки получают новые случайные параметры
+        // на своих местах, без обработки изображений и выделения памяти
+        void recycle(
+            const uint32_t width,
+            const uint32_t height,
+            const Snowflake_Sprite_Cache &cache,
+            std::mt19937 &gen);
         
-        // static void generate_snow(
-        //     const std::string &path_file,
-        //     const int width,
-        //     const int height,
-        //     const int fps,
-        //     std::vector<Interval_Snow> &schedule,
-        //     // const int num_snowflakes,
-        //     std::vector<cv::Mat> &vec_frames);
+        // Удаляет отмеченные, сохраняя порядок отрисовки остальных
+        void remove_culled();
+        
+        void save_state(Binary_Writer &writer) const;
+        
+        void load_state(Binary_Reader &reader);
         
     private:
-        bool need_remove;
+        void init(
+            const uint32_t idx,
+            const uint32_t width,
+            const uint32_t height,
+            const Snowflake_Sprite_Cache &cache,
+            std::mt19937 &gen);
         
-        cv::Point2f pos;
-        cv::Point2f velocity;
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> vx;
+        std::vector<float> vy;
         
-        float scale;
-        float rotation;
-        float rotation_speed;
+        // Угол в градусах, всегда в [0, 360)
+        std::vector<float> rotation;
+        std::vector<float> rotation_speed;
         
-        cv::Mat base_img;
-        cv::Mat rotated_img;
+        // Половина высоты спрайта корзины, для отсечения
+        std::vector<float> half_height;
+        
+        std::vector<Sprite_Handle> sprite;
+        
+        std::vector<uint8_t> is_out;
+    };
+    
+    // Изменяемое состояние снегопада перед очередным кадром
+    struct Snowfall_State
+    {
+        Snowflake_Particles snowflakes;
+        std::mt19937 gen;
+        bool is_active;
+        uint32_t idx_schedule;
     };
     
     class Snowfall
@@ -76,23 +123,57 @@ namespace InSomnia
             const std::string &path_file,
             const std::vector<Interval_Snow> &schedule,
             const int fps,
-            const uint32_t total_frames);
+            const uint32_t total_frames,
+            const int height,
+            const uint64_t seed);
         
+        // Кадры можно рисовать в любом порядке: состояние
+        // восстанавливается из ближайшего ключевого кадра
+        // и проигрывается вперёд с того же генератора
         void render(
             const uint32_t frame_idx,
             const int width,
             const int height,
             cv::Mat &frame);
         
+        void render(
+            const uint32_t frame_idx,
+            const int width,
+            const int height,
+            Frame_Yuv420 &frame);
+        
+        // Приводит state к состоянию перед кадром frame_idx
+        void seek(
+            const uint32_t frame_idx,
+            const int width,
+            const int height);
+        
+        // Состояние перед кадром next_frame: снежинки, генератор,
+        // интервал расписания. Ключевые кадры не сохраняются
+        void save_state(Binary_Writer &writer) const;
+        
+        void load_state(Binary_Reader &reader);
+        
     private:
-        cv::Mat img_snowflake;
+        // Движение, перезапуск и появление снежинок на кадре
+        // frame_idx без отрисовки
+        void simulate_frame(
+            const uint32_t frame_idx,
+            const int width,
+            const int height);
+        
         std::vector<Interval_Snow> schedule;
         
+        // Общий кеш повёрнутых спрайтов по корзинам масштаба
+        std::shared_ptr<const Snowflake_Sprite_Cache> sprite_cache;
+        
         uint32_t time_create_snowflake;
-        bool is_active;
-        uint32_t idx_schedule;
         
-        std::vector<Snowflake> snowflakes;
+        Snowfall_State state; // Состояние перед кадром next_frame
+        uint32_t next_frame;
+        
+        // keyframes[i] — состояние перед кадром i * keyframe_interval
+        std::vector<Snowfall_State> keyframes;
     };
 }
 
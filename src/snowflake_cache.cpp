@@ -0,0 +1,174 @@
+#include "snowflake_cache.h"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace InSomnia
+{
+    Snowflake_Sprite_Cache::Snowflake_Sprite_Cache(
+        const std::string &path_file,
+        const int height,
+        const float scale_min,
+        const float scale_max,
+        const uint32_t count_buckets,
+        const uint32_t count_angles)
+    {
+        if (count_buckets == 0u || count_buckets > 0xFFFFu ||
+            count_angles == 0u || count_angles > 0xFFFFu)
+        {
+            throw std::runtime_error(
+                "Ошибка: неверные параметры кеша снежинок\n");
+        }
+        
+        const cv::Mat snow_img =
+            cv::imread(path_file, cv::IMREAD_UNCHANGED);
+        
+        if (snow_img.empty())
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось загрузить файл snow.png\n");
+        }
+        
+        const cv::Mat snow_img_rgba =
+            InSomnia::convert_to_rgba(snow_img);
+        
+        const cv::Mat img_snowflake =
+            InSomnia::clear_alpha(snow_img_rgba);
+        
+        // Корзины масштаба равномерно в логарифмической шкале
+        // от scale_min до scale_max
+        this->bucket_scales = std::vector<float>(count_buckets);
+        this->atlases = std::vector<Rotation_Atlas>(count_buckets);
+        
+        for (uint32_t i = 0u; i < count_buckets; ++i)
+        {
+            const float t = count_buckets > 1u ?
+                static_cast<float>(i) / (count_buckets - 1) : 0.f;
+            const float scale =
+                scale_min * std::pow(scale_max / scale_min, t);
+            this->bucket_scales[i] = scale;
+            
+            const int target_height =
+                std::max(1, static_cast<int>(height * scale));
+            const int target_width = std::max(1, static_cast<int>(
+                img_snowflake.cols * (
+                    (float)target_height / img_snowflake.rows)));
+            
+            cv::Mat resized;
+            cv::resize(
+                img_snowflake,
+                resized,
+                cv::Size(target_width, target_height),
+                0,
+                0,
+                cv::INTER_AREA);
+            
+            this->atlases[i] = Rotation_Atlas(resized, count_angles);
+        }
+    }
+    
+    std::shared_ptr<const Snowflake_Sprite_Cache>
+    Snowflake_Sprite_Cache::get_shared(
+        const std::string &path_file,
+        const int height,
+        const float scale_min,
+        const float scale_max,
+        const uint32_t count_buckets,
+        const uint32_t count_angles)
+    {
+        using Key = std::tuple<
+            std::string, int, float, float, uint32_t, uint32_t>;
+        
+        static std::mutex mutex;
+        static std::map<
+            Key, std::weak_ptr<const Snowflake_Sprite_Cache>> registry;
+        
+        const Key key(
+            path_file,
+            height,
+            scale_min,
+            scale_max,
+            count_buckets,
+            count_angles);
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        std::shared_ptr<const Snowflake_Sprite_Cache> cache =
+            registry[key].lock();
+        
+        if (!cache)
+        {
+            cache = std::make_shared<const Snowflake_Sprite_Cache>(
+                path_file,
+                height,
+                scale_min,
+                scale_max,
+                count_buckets,
+                count_angles);
+            registry[key] = cache;
+        }
+        
+        return cache;
+    }
+    
+    uint32_t Snowflake_Sprite_Cache::get_count_buckets() const
+    {
+        return this->bucket_scales.size();
+    }
+    
+    uint32_t Snowflake_Sprite_Cache::get_count_angles() const
+    {
+        return this->atlases.front().get_count_angles();
+    }
+    
+    float Snowflake_Sprite_Cache::get_bucket_scale(
+        const uint32_t idx_bucket) const
+    {
+        return this->bucket_scales[idx_bucket];
+    }
+    
+    uint32_t Snowflake_Sprite_Cache::scale_to_bucket(
+        const float scale) const
+    {
+        const uint32_t count = this->bucket_scales.size();
+        if (count < 2u)
+        {
+            return 0u;
+        }
+        
+        const float t =
+            std::log(scale / this->bucket_scales.front()) /
+            std::log(this->bucket_scales.back() / this->bucket_scales.front());
+        const long idx = std::lround(t * (count - 1));
+        
+        return static_cast<uint32_t>(
+            std::max(0L, std::min(static_cast<long>(count - 1), idx)));
+    }
+    
+    Sprite_Handle Snowflake_Sprite_Cache::make_handle(
+        const uint32_t idx_bucket,
+        const float angle) const
+    {
+        Sprite_Handle handle;
+        handle.idx_bucket = static_cast<uint16_t>(idx_bucket);
+        handle.idx_angle = static_cast<uint16_t>(
+            this->atlases[idx_bucket].angle_to_index(angle));
+        
+        return handle;
+    }
+    
+    const Sprite& Snowflake_Sprite_Cache::get_sprite(
+        const Sprite_Handle handle) const
+    {
+        return this->atlases[handle.idx_bucket].get_sprite(handle.idx_angle);
+    }
+    
+    const Yuv_Sprite& Snowflake_Sprite_Cache::get_sprite_yuv(
+        const Sprite_Handle handle) const
+    {
+        return this->atlases[handle.idx_bucket].get_sprite_yuv(
+            handle.idx_angle);
+    }
+    
+}
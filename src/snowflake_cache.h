@@ -0,0 +1,71 @@
+#ifndef INSOMNIA_SNOWFLAKE_CACHE_H
+#define INSOMNIA_SNOWFLAKE_CACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "toolbox.h"
+#include "sprite.h"
+#include "rotation_atlas.h"
+
+namespace InSomnia
+{
+    // Лёгкая ссылка на спрайт в кеше: корзина масштаба и угол
+    struct Sprite_Handle
+    {
+        uint16_t idx_bucket;
+        uint16_t idx_angle;
+    };
+    
+    // Неизменяемый кеш спрайтов снежинки: изображение загружено,
+    // уменьшено до каждой корзины масштаба и повёрнуто заранее.
+    // Появление и перезапуск снежинки не обрабатывают изображений
+    // и не выделяют память
+    class Snowflake_Sprite_Cache
+    {
+    public:
+        Snowflake_Sprite_Cache(
+            const std::string &path_file,
+            const int height,
+            const float scale_min,
+            const float scale_max,
+            const uint32_t count_buckets,
+            const uint32_t count_angles);
+        
+        // Общий для всех снегопадов кеш с такими же параметрами:
+        // строится при первом запросе, пока на него есть ссылки
+        static std::shared_ptr<const Snowflake_Sprite_Cache> get_shared(
+            const std::string &path_file,
+            const int height,
+            const float scale_min,
+            const float scale_max,
+            const uint32_t count_buckets,
+            const uint32_t count_angles);
+        
+        uint32_t get_count_buckets() const;
+        
+        uint32_t get_count_angles() const;
+        
+        float get_bucket_scale(const uint32_t idx_bucket) const;
+        
+        // Ближайшая корзина в логарифмической шкале
+        uint32_t scale_to_bucket(const float scale) const;
+        
+        Sprite_Handle make_handle(
+            const uint32_t idx_bucket,
+            const float angle) const;
+        
+        const Sprite& get_sprite(const Sprite_Handle handle) const;
+        
+        const Yuv_Sprite& get_sprite_yuv(const Sprite_Handle handle) const;
+        
+    private:
+        std::vector<float> bucket_scales;
+        std::vector<Rotation_Atlas> atlases;
+    };
+}
+
+#endif
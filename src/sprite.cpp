@@ -0,0 +1,263 @@
+#include "sprite.h"
+
+#include <cstring>
+
+#include "compositor.h"
+
+namespace InSomnia
+{
+    Sprite::Sprite()
+    {
+        this->width = 0;
+        this->height = 0;
+        this->row_begin = { 0u };
+    }
+    
+    Sprite::Sprite(const cv::Mat &img)
+        : Sprite(img, false)
+    {
+        
+    }
+    
+    Sprite::Sprite(
+        const cv::Mat &img,
+        const bool is_premultiplied)
+    {
+        if (img.channels() != 4)
+        {
+            throw std::runtime_error(
+                "Ошибка: спрайт должен быть в формате BGRA!\n");
+        }
+        
+        this->width = img.cols;
+        this->height = img.rows;
+        
+        // Границы по альфе
+        int min_x = img.cols;
+        int min_y = img.rows;
+        int max_x = -1;
+        int max_y = -1;
+        
+        for (int y = 0; y < img.rows; ++y)
+        {
+            const cv::Vec4b *row = img.ptr<cv::Vec4b>(y);
+            for (int x = 0; x < img.cols; ++x)
+            {
+                if (row[x][3] > 0)
+                {
+                    min_x = std::min(min_x, x);
+                    max_x = std::max(max_x, x);
+                    min_y = std::min(min_y, y);
+                    max_y = std::max(max_y, y);
+                }
+            }
+        }
+        
+        this->row_begin = { 0u };
+        
+        if (max_x < 0)
+        {
+            // Полностью прозрачное изображение
+            this->bounds = cv::Rect(0, 0, 0, 0);
+            return;
+        }
+        
+        this->bounds = cv::Rect(
+            min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+        
+        const cv::Mat cropped = img(this->bounds);
+        
+        this->pixels.create(
+            this->bounds.height, this->bounds.width, CV_8UC4);
+        this->pixels_bgr.create(
+            this->bounds.height, this->bounds.width, CV_8UC3);
+        
+        this->row_begin.reserve(this->bounds.height + 1);
+        
+        for (int y = 0; y < this->bounds.height; ++y)
+        {
+            const cv::Vec4b *src = cropped.ptr<cv::Vec4b>(y);
+            cv::Vec4b *dst = this->pixels.ptr<cv::Vec4b>(y);
+            cv::Vec3b *dst_bgr = this->pixels_bgr.ptr<cv::Vec3b>(y);
+            
+            for (int x = 0; x < this->bounds.width; ++x)
+            {
+                const uint32_t a = src[x][3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    const uint8_t c = is_premultiplied ?
+                        static_cast<uint8_t>(std::min<uint32_t>(src[x][i], a)) :
+                        static_cast<uint8_t>((src[x][i] * a + 127u) / 255u);
+                    dst[x][i] = c;
+                    dst_bgr[x][i] = c;
+                }
+                dst[x][3] = static_cast<uint8_t>(a);
+            }
+            
+            const auto type_of = [src](const int i) -> Run_Type
+            {
+                const uint8_t a = src[i][3];
+                if (a == 0)
+                {
+                    return Run_Type::skip;
+                }
+                if (a == 255)
+                {
+                    return Run_Type::copy;
+                }
+                return Run_Type::blend;
+            };
+            
+            // Склеиваем соседние пиксели одного типа в отрезки
+            int x = 0;
+            while (x < this->bounds.width)
+            {
+                const Run_Type type = type_of(x);
+                int x_end = x + 1;
+                while (x_end < this->bounds.width &&
+                       type_of(x_end) == type)
+                {
+                    ++x_end;
+                }
+                
+                this->runs.push_back({ x, x_end, type });
+                x = x_end;
+            }
+            
+            this->row_begin.push_back(this->runs.size());
+        }
+    }
+    
+    bool Sprite::empty() const
+    {
+        return this->bounds.width <= 0 || this->bounds.height <= 0;
+    }
+    
+    int Sprite::get_width() const
+    {
+        return this->width;
+    }
+    
+    int Sprite::get_height() const
+    {
+        return this->height;
+    }
+    
+    const cv::Rect& Sprite::get_bounds() const
+    {
+        return this->bounds;
+    }
+    
+    const cv::Mat& Sprite::get_pixels() const
+    {
+        return this->pixels;
+    }
+    
+    const cv::Mat& Sprite::get_pixels_bgr() const
+    {
+        return this->pixels_bgr;
+    }
+    
+    const Sprite_Run* Sprite::get_runs_begin(const int y) const
+    {
+        return this->runs.data() + this->row_begin[y];
+    }
+    
+    const Sprite_Run* Sprite::get_runs_end(const int y) const
+    {
+        return this->runs.data() + this->row_begin[y + 1];
+    }
+    
+    void draw_sprite_to_frame(
+        const Sprite &sprite,
+        const float x,
+        const float y,
+        cv::Mat &frame)
+    {
+        draw_sprite_to_frame(sprite, x, y, 0, frame.rows, frame);
+    }
+    
+    void draw_sprite_to_frame(
+        const Sprite &sprite,
+        const float x,
+        const float y,
+        const int row_begin,
+        const int row_end,
+        cv::Mat &frame)
+    {
+        if (sprite.empty() ||
+            frame.empty() ||
+            frame.channels() != 3)
+        {
+            return;
+        }
+        
+        const cv::Rect &bounds = sprite.get_bounds();
+        
+        // Левый верхний угол обрезанной части в координатах кадра
+        const int x_origin =
+            static_cast<int>(x - sprite.get_width() / 2.0f) + bounds.x;
+        const int y_origin =
+            static_cast<int>(y - sprite.get_height() / 2.0f) + bounds.y;
+        
+        const int start_dy =
+            std::max(0, std::max(0, row_begin) - y_origin);
+        const int end_dy = std::min(
+            bounds.height,
+            std::min(frame.rows, row_end) - y_origin);
+        const int clip_begin = -x_origin;
+        const int clip_end = frame.cols - x_origin;
+        
+        if (start_dy >= end_dy ||
+            clip_begin >= bounds.width ||
+            clip_end <= 0)
+        {
+            return;
+        }
+        
+        const Blend_Row_Function blend_row =
+            get_blend_row_premultiplied();
+        
+        for (int dy = start_dy; dy < end_dy; ++dy)
+        {
+            const uint8_t *src = sprite.get_pixels().ptr<uint8_t>(dy);
+            const uint8_t *src_bgr =
+                sprite.get_pixels_bgr().ptr<uint8_t>(dy);
+            uint8_t *dst_row = frame.ptr<uint8_t>(y_origin + dy);
+            
+            const Sprite_Run *it_end = sprite.get_runs_end(dy);
+            for (const Sprite_Run *it = sprite.get_runs_begin(dy);
+                 it != it_end;
+                 ++it)
+            {
+                if (it->type == Run_Type::skip)
+                {
+                    continue;
+                }
+                
+                const int x_begin = std::max(it->x_begin, clip_begin);
+                const int x_end = std::min(it->x_end, clip_end);
+                if (x_begin >= x_end)
+                {
+                    continue;
+                }
+                
+                if (it->type == Run_Type::copy)
+                {
+                    std::memcpy(
+                        dst_row + 3 * (x_origin + x_begin),
+                        src_bgr + 3 * x_begin,
+                        3 * (x_end - x_begin));
+                }
+                else
+                {
+                    blend_row(
+                        src + 4 * x_begin,
+                        dst_row + 3 * (x_origin + x_begin),
+                        x_end - x_begin);
+                }
+            }
+        }
+    }
+    
+}
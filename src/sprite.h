@@ -0,0 +1,89 @@
+#ifndef INSOMNIA_SPRITE_H
+#define INSOMNIA_SPRITE_H
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace InSomnia
+{
+    enum class Run_Type : uint8_t
+    {
+        skip,  // alpha == 0, кадр не трогаем
+        copy,  // alpha == 255, копируем цвет целиком
+        blend  // сглаженные края, смешиваем
+    };
+    
+    // Отрезок строки [x_begin, x_end) в координатах обрезанного спрайта
+    struct Sprite_Run
+    {
+        int x_begin;
+        int x_end;
+        Run_Type type;
+    };
+    
+    // Подготовленный при загрузке спрайт: обрезан по альфе,
+    // цвет умножен на альфу, строки разбиты на отрезки
+    class Sprite
+    {
+    public:
+        Sprite();
+        
+        // img — BGRA после convert_to_rgba/clear_alpha
+        explicit Sprite(const cv::Mat &img);
+        
+        // is_premultiplied — цвет в img уже умножен на альфу
+        Sprite(
+            const cv::Mat &img,
+            const bool is_premultiplied);
+        
+        bool empty() const;
+        
+        // Размер исходного изображения (центр спрайта считается по нему)
+        int get_width() const;
+        int get_height() const;
+        
+        // Непрозрачная часть в координатах исходного изображения
+        const cv::Rect& get_bounds() const;
+        
+        // BGRA с умноженной альфой, размер bounds
+        const cv::Mat& get_pixels() const;
+        
+        // BGR для отрезков copy, размер bounds
+        const cv::Mat& get_pixels_bgr() const;
+        
+        // Отрезки строки y (0 <= y < bounds.height)
+        const Sprite_Run* get_runs_begin(const int y) const;
+        const Sprite_Run* get_runs_end(const int y) const;
+        
+    private:
+        int width;
+        int height;
+        cv::Rect bounds;
+        
+        cv::Mat pixels;
+        cv::Mat pixels_bgr;
+        
+        std::vector<Sprite_Run> runs;
+        std::vector<uint32_t> row_begin; // bounds.height + 1 элементов
+    };
+    
+    // x, y — центр спрайта
+    void draw_sprite_to_frame(
+        const Sprite &sprite,
+        const float x,
+        const float y,
+        cv::Mat &frame);
+    
+    // То же, но пишет только строки кадра [row_begin, row_end):
+    // полосы кадра можно рисовать из разных потоков без блокировок
+    void draw_sprite_to_frame(
+        const Sprite &sprite,
+        const float x,
+        const float y,
+        const int row_begin,
+        const int row_end,
+        cv::Mat &frame);
+}
+
+#endif
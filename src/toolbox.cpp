@@ -25,30 +25,6 @@ namespace InSomnia
         return result;
     }
     
-    // Смешиваем пиксель с фоном по альфа-каналу (корректно для BGR)
-    void blend_pixel(
-        cv::Mat &frame,
-        int32_t x,
-        int32_t y,
-        const cv::Vec4b &pixel)
-    {
-        if (x < 0 || x >= frame.cols || y < 0 || y >= frame.rows) {
-            return;
-        }
-    
-        cv::Vec3b bg = frame.at<cv::Vec3b>(y, x);
-        float alpha = pixel[3] / 255.0f;
-    
-        cv::Vec3b result;
-        for (int i = 0; i < 3; ++i) {
-            result[i] = static_cast<uchar>(
-                alpha * pixel[i] + (1 - alpha) * bg[i]
-            );
-        }
-    
-        frame.at<cv::Vec3b>(y, x) = result;
-    }
-    
     cv::Mat convert_to_rgba(const cv::Mat &input)
     {
         cv::Mat img_rgba;
@@ -68,124 +44,22 @@ namespace InSomnia
         return img_rgba;
     }
     
-    void draw_figure_to_frame(
-        const cv::Mat &figure,
-        const float x,
-        const float y,
-        cv::Mat &frame)
-    {
-        if (figure.empty() ||
-            figure.channels() != 4 ||
-            frame.empty() ||
-            frame.channels() != 3)
-        {
-            return;
-        }
-        
-        const uint32_t r = figure.rows;
-        const uint32_t c = figure.cols;
-        const uint32_t width = frame.cols;
-        const uint32_t height = frame.rows;
-        
-        // ✅ Теперь x, y — это центр изображения
-        const int x_offset = static_cast<int>(x - c / 2.0f);
-        const int y_offset = static_cast<int>(y - r / 2.0f);
-        
-        // Ограничиваем start/end, чтобы не выйти за пределы figure
-        const int start_dy = std::max(0, std::min((int)r, -y_offset));
-        const int end_dy   = std::min((int)r, std::max(0, (int)height - y_offset));
-        const int start_dx = std::max(0, std::min((int)c, -x_offset));
-        const int end_dx   = std::min((int)c, std::max(0, (int)width - x_offset));
-        
-        for (int dy = start_dy; dy < end_dy; ++dy)
-        {
-            for (int dx = start_dx; dx < end_dx; ++dx)
-            {
-                const int32_t px = x_offset + dx;
-                const int32_t py = y_offset + dy;
-    
-                if (px < 0 || px >= width || py < 0 || py >= height)
-                {
-                    continue;
-                }
-    
-                // Проверка: не выходим ли за пределы figure
-                if (dy >= r || dx >= c)
-                {
-                    continue;
-                }
-    
-                const cv::Vec4b pixel = figure.at<cv::Vec4b>(dy, dx);
-                if (pixel[3] > 0)
-                {
-                    blend_pixel(frame, px, py, pixel);
-                }
-            }
-        }
-    }
-    
-    std::vector<cv::Mat> prepare_frames(
-        const int width,
-        const int height,
-        const int total_frames,
-        const int type)
+    uint64_t hash_counter(
+        const uint64_t seed,
+        const uint64_t counter)
     {
-        std::vector<cv::Mat> vec_frames(total_frames);
-        
-        for (uint32_t frame_idx = 0u;
-             frame_idx < total_frames;
-             ++frame_idx)
-        {
-            cv::Mat frame =
-                cv::Mat::zeros(height, width, type /*CV_8UC3*/); // чёрный фон
-            vec_frames[frame_idx] = std::move(frame);
-        }
-        
-        return vec_frames;
+        uint64_t z = seed + (counter + 1) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
     }
     
-    void write_video_to_file(
-        const std::string &path_file,
-        const int width,
-        const int height,
-        const int fps,
-        const std::vector<cv::Mat> &vec_frames)
+    float uniform_counter(
+        const uint64_t seed,
+        const uint64_t counter)
     {
-        const uint32_t total_frames = vec_frames.size();
-        
-        cv::VideoWriter video_writer(
-            path_file,
-            cv::VideoWriter::fourcc('m', 'p', '4', 'v'), 
-            fps,
-            cv::Size(width, height));
-        
-        if (!video_writer.isOpened())
-        {
-            throw std::runtime_error(
-                "Ошибка: не удалось открыть VideoWriter\n");
-        }
-        
-        for (uint32_t frame_idx = 0u;
-             frame_idx < total_frames;
-             ++frame_idx)
-        {
-            const cv::Mat &frame = vec_frames[frame_idx];
-            
-            video_writer.write(frame);
-            
-            if ((frame_idx + 1) % fps == 0)
-            {
-                std::cout << std::format(
-                    "Записано кадров: {} из {}\n",
-                    frame_idx + 1, total_frames);
-                std::cout.flush();
-            }
-        }
-        
-        video_writer.release();
-        
-        std::cout << "Видео сохранено как " << path_file << "\n";
-        std::cout.flush();
+        // Старшие 24 бита — ровно столько помещается в мантиссу float
+        return (hash_counter(seed, counter) >> 40) * (1.f / 16777216.f);
     }
     
 }
@@ -7,33 +7,18 @@ namespace InSomnia
 {
     cv::Mat clear_alpha(const cv::Mat img);
     
-    void blend_pixel(
-        cv::Mat &frame,
-        int32_t x,
-        int32_t y,
-        const cv::Vec4b &pixel);
-    
     cv::Mat convert_to_rgba(const cv::Mat &input);
     
-    // Можно оптимизировать
-    void draw_figure_to_frame(
-        const cv::Mat &figure,
-        const float x,
-        const float y,
-        cv::Mat &frame);
-    
-    std::vector<cv::Mat> prepare_frames(
-        const int width,
-        const int height,
-        const int total_frames,
-        const int type);
+    // Счётный генератор (splitmix64): одно и то же число
+    // для одних и тех же seed и counter при любом порядке вызовов
+    uint64_t hash_counter(
+        const uint64_t seed,
+        const uint64_t counter);
     
-    void write_video_to_file(
-        const std::string &path_file,
-        const int width,
-        const int height,
-        const int fps,
-        const std::vector<cv::Mat> &vec_frames);
+    // Равномерное число в [0, 1) по seed и counter
+    float uniform_counter(
+        const uint64_t seed,
+        const uint64_t counter);
 }
 
 #endif
@@ -0,0 +1,244 @@
+#include "y4m_sink.h"
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+
+namespace InSomnia
+{
+    using Clock = std::chrono::steady_clock;
+    
+    static double seconds_since(const Clock::time_point time_begin)
+    {
+        return std::chrono::duration<double>(Clock::now() - time_begin).count();
+    }
+    
+    Y4m_Sink::Y4m_Sink(
+        const std::string &path_file,
+        const int width,
+        const int height,
+        const int fps) :
+        Y4m_Sink(path_file, width, height, fps, 0u)
+    {
+        
+    }
+    
+    Y4m_Sink::Y4m_Sink(
+        const std::string &path_file,
+        const int width,
+        const int height,
+        const int fps,
+        const uint32_t count_frames_keep)
+    {
+        // 4:2:0 требует чётных сторон
+        if (width <= 0 || height <= 0 || width % 2 != 0 || height % 2 != 0)
+        {
+            throw std::runtime_error(
+                "Ошибка: для Y4M нужны чётные ширина и высота\n");
+        }
+        
+        this->size = cv::Size(width, height);
+        this->stats = Sink_Stats();
+        
+        // C420jpeg — обычный yuv420p для ffmpeg
+        const std::string header = std::format(
+            "YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg\n",
+            width, height, fps);
+        
+        this->is_stdout = (path_file == "-");
+        
+        if (count_frames_keep > 0u)
+        {
+            if (this->is_stdout)
+            {
+                throw std::runtime_error(
+                    "Ошибка: в stdout нельзя дописать Y4M\n");
+            }
+            
+            this->truncate_after(path_file, header, count_frames_keep);
+        }
+        
+        this->file = this->is_stdout ?
+            stdout :
+            std::fopen(path_file.c_str(), count_frames_keep > 0u ? "ab" : "wb");
+        
+        if (this->file == nullptr)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось открыть файл " + path_file + "\n");
+        }
+        
+        // Буфер на несколько мегабайт вместо посимвольной записи
+        std::setvbuf(this->file, nullptr, _IOFBF, 8u << 20);
+        
+        if (count_frames_keep == 0u)
+        {
+            this->write_bytes(header.data(), header.size());
+        }
+    }
+    
+    Y4m_Sink::~Y4m_Sink()
+    {
+        if (this->file == nullptr)
+        {
+            return;
+        }
+        
+        if (this->is_stdout)
+        {
+            std::fflush(this->file);
+        }
+        else
+        {
+            std::fclose(this->file);
+        }
+    }
+    
+    void Y4m_Sink::push(
+        const uint32_t /*frame_idx*/,
+        const cv::Mat &frame)
+    {
+        if (this->file == nullptr)
+        {
+            throw std::runtime_error(
+                "Ошибка: Y4m_Sink уже закрыт\n");
+        }
+        
+        const bool is_yuv420 = is_yuv420_buffer(
+            frame, this->size.width, this->size.height);
+        
+        if (!is_yuv420 &&
+            (frame.size() != this->size || frame.type() != CV_8UC3))
+        {
+            throw std::runtime_error(
+                "Ошибка: кадр не совпадает с размером видео\n");
+        }
+        
+        const Clock::time_point time_begin = Clock::now();
+        
+        // Плоскости Y, U, V подряд: (height * 3 / 2) x width.
+        // Кадр, отрисованный сразу в YUV 4:2:0, пишется как есть
+        const cv::Mat *yuv_frame = &frame;
+        if (!is_yuv420)
+        {
+            cv::cvtColor(frame, this->yuv, cv::COLOR_BGR2YUV_I420);
+            yuv_frame = &(this->yuv);
+        }
+        
+        static constexpr char marker[] = "FRAME\n";
+        this->write_bytes(marker, sizeof(marker) - 1);
+        
+        if (yuv_frame->isContinuous())
+        {
+            this->write_bytes(yuv_frame->data, yuv_frame->total());
+        }
+        else
+        {
+            for (int y = 0; y < yuv_frame->rows; ++y)
+            {
+                this->write_bytes(yuv_frame->ptr(y), yuv_frame->cols);
+            }
+        }
+        
+        ++(this->stats.count_frames);
+        this->stats.seconds += seconds_since(time_begin);
+    }
+    
+    void Y4m_Sink::flush()
+    {
+        if (this->file == nullptr)
+        {
+            return;
+        }
+        
+        const Clock::time_point time_begin = Clock::now();
+        
+        std::fflush(this->file);
+        
+        this->stats.seconds += seconds_since(time_begin);
+    }
+    
+    void Y4m_Sink::close()
+    {
+        if (this->file == nullptr)
+        {
+            return;
+        }
+        
+        const Clock::time_point time_begin = Clock::now();
+        
+        const int result = this->is_stdout ?
+            std::fflush(this->file) : std::fclose(this->file);
+        this->file = nullptr;
+        
+        this->stats.seconds += seconds_since(time_begin);
+        
+        if (result != 0)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось дописать Y4M\n");
+        }
+    }
+    
+    Sink_Stats Y4m_Sink::get_stats() const
+    {
+        return this->stats;
+    }
+    
+    void Y4m_Sink::truncate_after(
+        const std::string &path_file,
+        const std::string &header,
+        const uint32_t count_frames_keep)
+    {
+        std::FILE *input = std::fopen(path_file.c_str(), "rb");
+        if (input == nullptr)
+        {
+            throw std::runtime_error(
+                "Ошибка: не удалось открыть файл " + path_file + "\n");
+        }
+        
+        std::string header_file(header.size(), '\0');
+        const bool is_read =
+            std::fread(header_file.data(), 1, header.size(), input) ==
+                header.size();
+        std::fclose(input);
+        
+        if (!is_read || header_file != header)
+        {
+            throw std::runtime_error(
+                "Ошибка: заголовок " + path_file +
+                " не совпадает с настройками видео\n");
+        }
+        
+        // Кадр — маркер FRAME и плоскости Y, U, V
+        const uint64_t size_frame =
+            6u + static_cast<uint64_t>(this->size.area()) * 3u / 2u;
+        const uint64_t size_keep =
+            header.size() + size_frame * count_frames_keep;
+        
+        if (std::filesystem::file_size(path_file) < size_keep)
+        {
+            throw std::runtime_error(
+                "Ошибка: в " + path_file +
+                " меньше кадров, чем в контрольной точке\n");
+        }
+        
+        // Кадры, записанные после контрольной точки, будут
+        // отрисованы заново
+        std::filesystem::resize_file(path_file, size_keep);
+    }
+    
+    void Y4m_Sink::write_bytes(
+        const void *data,
+        const size_t count)
+    {
+        if (std::fwrite(data, 1, count, this->file) != count)
+        {
+            throw std::runtime_error(
+                "Ошибка: запись Y4M не удалась\n");
+        }
+        
+        this->stats.bytes_written += count;
+    }
+    
+}
@@ -0,0 +1,72 @@
+#ifndef INSOMNIA_Y4M_SINK_H
+#define INSOMNIA_Y4M_SINK_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame_sink.h"
+#include "frame_yuv420.h"
+
+namespace InSomnia
+{
+    // Несжатый YUV4MPEG2 (4:2:0) в файл или в stdout ("-")
+    // для внешнего кодировщика: ffmpeg -i - ...
+    // OpenCV только переводит BGR в YUV, кодирования нет.
+    // Буфер I420 (Frame_Format::yuv420) пишется без преобразования
+    class Y4m_Sink : public Frame_Sink
+    {
+    public:
+        Y4m_Sink(
+            const std::string &path_file,
+            const int width,
+            const int height,
+            const int fps);
+        
+        // Продолжение файла после контрольной точки: первые
+        // count_frames_keep кадров остаются, всё после них
+        // отрезается, новые кадры дописываются следом.
+        // Заголовок файла должен совпадать с настройками
+        Y4m_Sink(
+            const std::string &path_file,
+            const int width,
+            const int height,
+            const int fps,
+            const uint32_t count_frames_keep);
+        
+        ~Y4m_Sink() override;
+        
+        Y4m_Sink(const Y4m_Sink &) = delete;
+        Y4m_Sink& operator=(const Y4m_Sink &) = delete;
+        
+        void push(
+            const uint32_t frame_idx,
+            const cv::Mat &frame) override;
+        
+        void flush() override;
+        
+        void close() override;
+        
+        Sink_Stats get_stats() const override;
+        
+    private:
+        std::FILE *file;
+        bool is_stdout;
+        cv::Size size;
+        cv::Mat yuv; // I420, переиспользуется между кадрами
+        Sink_Stats stats;
+        
+        void truncate_after(
+            const std::string &path_file,
+            const std::string &header,
+            const uint32_t count_frames_keep);
+        
+        void write_bytes(
+            const void *data,
+            const size_t count);
+    };
+}
+
+#endif
@@ -0,0 +1,345 @@
+#include "yuv_sprite.h"
+
+#include <cstring>
+
+#include "compositor.h"
+
+namespace InSomnia
+{
+    static inline uint8_t round_to_u8(
+        const float value,
+        const uint8_t limit)
+    {
+        const int v = static_cast<int>(value + 0.5f);
+        
+        return static_cast<uint8_t>(std::max(0, std::min<int>(limit, v)));
+    }
+    
+    Yuv_Sprite::Yuv_Sprite()
+    {
+        this->width = 0;
+        this->height = 0;
+        this->row_begin = { 0u };
+    }
+    
+    Yuv_Sprite::Yuv_Sprite(const Sprite &sprite)
+    {
+        this->width = sprite.get_width();
+        this->height = sprite.get_height();
+        this->bounds = sprite.get_bounds();
+        this->row_begin = { 0u };
+        
+        if (sprite.empty())
+        {
+            return;
+        }
+        
+        const int bw = this->bounds.width;
+        const int bh = this->bounds.height;
+        const cv::Mat &pixels = sprite.get_pixels();
+        
+        // Яркость и отрезки: отрезки copy копируются memcpy,
+        // поэтому у непрозрачных пикселей luma — готовый Y
+        this->luma.create(bh, bw, CV_8UC1);
+        this->luma_alpha.create(bh, bw, CV_8UC1);
+        
+        cv::Mat u_full(bh, bw, CV_32FC1);
+        cv::Mat v_full(bh, bw, CV_32FC1);
+        
+        this->row_begin.reserve(bh + 1);
+        
+        for (int y = 0; y < bh; ++y)
+        {
+            const cv::Vec4b *src = pixels.ptr<cv::Vec4b>(y);
+            uint8_t *dst_y = this->luma.ptr<uint8_t>(y);
+            uint8_t *dst_a = this->luma_alpha.ptr<uint8_t>(y);
+            float *dst_u = u_full.ptr<float>(y);
+            float *dst_v = v_full.ptr<float>(y);
+            
+            for (int x = 0; x < bw; ++x)
+            {
+                const uint8_t a = src[x][3];
+                const cv::Vec3f yuv = bgr_to_yuv_premultiplied(
+                    src[x][0], src[x][1], src[x][2], a);
+                
+                dst_y[x] = round_to_u8(yuv[0], a);
+                dst_a[x] = a;
+                dst_u[x] = yuv[1];
+                dst_v[x] = yuv[2];
+            }
+            
+            this->runs.insert(
+                this->runs.end(),
+                sprite.get_runs_begin(y),
+                sprite.get_runs_end(y));
+            this->row_begin.push_back(this->runs.size());
+        }
+        
+        // Цветность: среднее по блоку 2 x 2, пиксели за краем
+        // bounds прозрачны. Для умноженной альфы это точное
+        // смешивание четырёх пикселей
+        const int cw = (bw + 1) / 2;
+        const int ch = (bh + 1) / 2;
+        
+        this->chroma_u.create(ch, cw, CV_8UC1);
+        this->chroma_v.create(ch, cw, CV_8UC1);
+        this->chroma_alpha.create(ch, cw, CV_8UC1);
+        this->chroma_x_begin = std::vector<int>(ch, 0);
+        this->chroma_x_end = std::vector<int>(ch, 0);
+        
+        for (int cy = 0; cy < ch; ++cy)
+        {
+            uint8_t *dst_u = this->chroma_u.ptr<uint8_t>(cy);
+            uint8_t *dst_v = this->chroma_v.ptr<uint8_t>(cy);
+            uint8_t *dst_a = this->chroma_alpha.ptr<uint8_t>(cy);
+            
+            int x_begin = cw;
+            int x_end = 0;
+            
+            for (int cx = 0; cx < cw; ++cx)
+            {
+                float sum_u = 0.f;
+                float sum_v = 0.f;
+                float sum_a = 0.f;
+                
+                for (int dy = 0; dy < 2; ++dy)
+                {
+                    const int y = 2 * cy + dy;
+                    if (y >= bh)
+                    {
+                        continue;
+                    }
+                    
+                    for (int dx = 0; dx < 2; ++dx)
+                    {
+                        const int x = 2 * cx + dx;
+                        if (x >= bw)
+                        {
+                            continue;
+                        }
+                        
+                        sum_u += u_full.at<float>(y, x);
+                        sum_v += v_full.at<float>(y, x);
+                        sum_a += this->luma_alpha.at<uint8_t>(y, x);
+                    }
+                }
+                
+                const uint8_t a = round_to_u8(sum_a / 4.f, 255);
+                dst_a[cx] = a;
+                dst_u[cx] = round_to_u8(sum_u / 4.f, a);
+                dst_v[cx] = round_to_u8(sum_v / 4.f, a);
+                
+                if (a > 0)
+                {
+                    x_begin = std::min(x_begin, cx);
+                    x_end = cx + 1;
+                }
+            }
+            
+            this->chroma_x_begin[cy] = std::min(x_begin, x_end);
+            this->chroma_x_end[cy] = x_end;
+        }
+    }
+    
+    bool Yuv_Sprite::empty() const
+    {
+        return this->bounds.width <= 0 || this->bounds.height <= 0;
+    }
+    
+    int Yuv_Sprite::get_width() const
+    {
+        return this->width;
+    }
+    
+    int Yuv_Sprite::get_height() const
+    {
+        return this->height;
+    }
+    
+    const cv::Rect& Yuv_Sprite::get_bounds() const
+    {
+        return this->bounds;
+    }
+    
+    const cv::Mat& Yuv_Sprite::get_luma() const
+    {
+        return this->luma;
+    }
+    
+    const cv::Mat& Yuv_Sprite::get_luma_alpha() const
+    {
+        return this->luma_alpha;
+    }
+    
+    const cv::Mat& Yuv_Sprite::get_chroma_u() const
+    {
+        return this->chroma_u;
+    }
+    
+    const cv::Mat& Yuv_Sprite::get_chroma_v() const
+    {
+        return this->chroma_v;
+    }
+    
+    const cv::Mat& Yuv_Sprite::get_chroma_alpha() const
+    {
+        return this->chroma_alpha;
+    }
+    
+    int Yuv_Sprite::get_chroma_x_begin(const int y) const
+    {
+        return this->chroma_x_begin[y];
+    }
+    
+    int Yuv_Sprite::get_chroma_x_end(const int y) const
+    {
+        return this->chroma_x_end[y];
+    }
+    
+    const Sprite_Run* Yuv_Sprite::get_runs_begin(const int y) const
+    {
+        return this->runs.data() + this->row_begin[y];
+    }
+    
+    const Sprite_Run* Yuv_Sprite::get_runs_end(const int y) const
+    {
+        return this->runs.data() + this->row_begin[y + 1];
+    }
+    
+    void draw_sprite_to_frame(
+        const Yuv_Sprite &sprite,
+        const float x,
+        const float y,
+        Frame_Yuv420 &frame)
+    {
+        draw_sprite_to_frame(sprite, x, y, 0, frame.get_height(), frame);
+    }
+    
+    void draw_sprite_to_frame(
+        const Yuv_Sprite &sprite,
+        const float x,
+        const float y,
+        const int row_begin,
+        const int row_end,
+        Frame_Yuv420 &frame)
+    {
+        if (sprite.empty())
+        {
+            return;
+        }
+        
+        const cv::Rect &bounds = sprite.get_bounds();
+        const int frame_width = frame.get_width();
+        const int frame_height = frame.get_height();
+        
+        // Левый верхний угол — как в BGR-версии
+        const int x_origin =
+            static_cast<int>(x - sprite.get_width() / 2.0f) + bounds.x;
+        const int y_origin =
+            static_cast<int>(y - sprite.get_height() / 2.0f) + bounds.y;
+        
+        // Яркость
+        
+        cv::Mat &plane_y = frame.get_y();
+        
+        const int start_dy =
+            std::max(0, std::max(0, row_begin) - y_origin);
+        const int end_dy = std::min(
+            bounds.height,
+            std::min(frame_height, row_end) - y_origin);
+        const int clip_begin = -x_origin;
+        const int clip_end = frame_width - x_origin;
+        
+        if (clip_begin >= bounds.width || clip_end <= 0)
+        {
+            return;
+        }
+        
+        for (int dy = start_dy; dy < end_dy; ++dy)
+        {
+            const uint8_t *src = sprite.get_luma().ptr<uint8_t>(dy);
+            const uint8_t *src_alpha =
+                sprite.get_luma_alpha().ptr<uint8_t>(dy);
+            uint8_t *dst_row = plane_y.ptr<uint8_t>(y_origin + dy);
+            
+            const Sprite_Run *it_end = sprite.get_runs_end(dy);
+            for (const Sprite_Run *it = sprite.get_runs_begin(dy);
+                 it != it_end;
+                 ++it)
+            {
+                if (it->type == Run_Type::skip)
+                {
+                    continue;
+                }
+                
+                const int x_begin = std::max(it->x_begin, clip_begin);
+                const int x_end = std::min(it->x_end, clip_end);
+                if (x_begin >= x_end)
+                {
+                    continue;
+                }
+                
+                if (it->type == Run_Type::copy)
+                {
+                    std::memcpy(
+                        dst_row + x_origin + x_begin,
+                        src + x_begin,
+                        x_end - x_begin);
+                }
+                else
+                {
+                    blend_plane_premultiplied(
+                        src + x_begin,
+                        src_alpha + x_begin,
+                        dst_row + x_origin + x_begin,
+                        x_end - x_begin);
+                }
+            }
+        }
+        
+        // Цветность: угол округляется вниз до чётного
+        
+        cv::Mat &plane_u = frame.get_u();
+        cv::Mat &plane_v = frame.get_v();
+        
+        const int cx_origin = x_origin >> 1;
+        const int cy_origin = y_origin >> 1;
+        const int count_rows = sprite.get_chroma_alpha().rows;
+        
+        const int start_cy =
+            std::max(0, std::max(0, row_begin / 2) - cy_origin);
+        const int end_cy = std::min(
+            count_rows,
+            std::min(plane_u.rows, row_end / 2) - cy_origin);
+        const int clip_chroma_begin = -cx_origin;
+        const int clip_chroma_end = plane_u.cols - cx_origin;
+        
+        for (int cy = start_cy; cy < end_cy; ++cy)
+        {
+            const int x_begin = std::max(
+                sprite.get_chroma_x_begin(cy), clip_chroma_begin);
+            const int x_end = std::min(
+                sprite.get_chroma_x_end(cy), clip_chroma_end);
+            if (x_begin >= x_end)
+            {
+                continue;
+            }
+            
+            const uint8_t *src_alpha =
+                sprite.get_chroma_alpha().ptr<uint8_t>(cy) + x_begin;
+            const int offset = cx_origin + x_begin;
+            
+            blend_plane_premultiplied(
+                sprite.get_chroma_u().ptr<uint8_t>(cy) + x_begin,
+                src_alpha,
+                plane_u.ptr<uint8_t>(cy_origin + cy) + offset,
+                x_end - x_begin);
+            blend_plane_premultiplied(
+                sprite.get_chroma_v().ptr<uint8_t>(cy) + x_begin,
+                src_alpha,
+                plane_v.ptr<uint8_t>(cy_origin + cy) + offset,
+                x_end - x_begin);
+        }
+    }
+    
+}
@@ -0,0 +1,88 @@
+#ifndef INSOMNIA_YUV_SPRITE_H
+#define INSOMNIA_YUV_SPRITE_H
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "sprite.h"
+#include "frame_yuv420.h"
+
+namespace InSomnia
+{
+    // Спрайт для кадра YUV 4:2:0, переведённый из Sprite один раз
+    // при загрузке. Яркость в полном разрешении с отрезками
+    // исходного спрайта, цветность — средние по блокам 2 x 2.
+    // Все плоскости умножены на альфу
+    class Yuv_Sprite
+    {
+    public:
+        Yuv_Sprite();
+        
+        explicit Yuv_Sprite(const Sprite &sprite);
+        
+        bool empty() const;
+        
+        int get_width() const;
+        int get_height() const;
+        
+        const cv::Rect& get_bounds() const;
+        
+        // Размер bounds
+        const cv::Mat& get_luma() const;
+        const cv::Mat& get_luma_alpha() const;
+        
+        // Размер bounds / 2 с округлением вверх: блок (i, j)
+        // покрывает пиксели яркости (2i, 2j) .. (2i + 1, 2j + 1)
+        const cv::Mat& get_chroma_u() const;
+        const cv::Mat& get_chroma_v() const;
+        const cv::Mat& get_chroma_alpha() const;
+        
+        // Непрозрачная часть строки цветности [begin, end)
+        int get_chroma_x_begin(const int y) const;
+        int get_chroma_x_end(const int y) const;
+        
+        const Sprite_Run* get_runs_begin(const int y) const;
+        const Sprite_Run* get_runs_end(const int y) const;
+        
+    private:
+        int width;
+        int height;
+        cv::Rect bounds;
+        
+        cv::Mat luma;
+        cv::Mat luma_alpha;
+        
+        cv::Mat chroma_u;
+        cv::Mat chroma_v;
+        cv::Mat chroma_alpha;
+        
+        std::vector<int> chroma_x_begin;
+        std::vector<int> chroma_x_end;
+        
+        std::vector<Sprite_Run> runs;
+        std::vector<uint32_t> row_begin; // bounds.height + 1 элементов
+    };
+    
+    // x, y — центр спрайта, как у BGR-версии. Яркость ложится
+    // в то же место, что и в кадре BGR, цветность — в блок 2 x 2,
+    // содержащий левый верхний угол (смещение до пикселя)
+    void draw_sprite_to_frame(
+        const Yuv_Sprite &sprite,
+        const float x,
+        const float y,
+        Frame_Yuv420 &frame);
+    
+    // Только строки яркости [row_begin, row_end) и строки
+    // цветности [row_begin / 2, row_end / 2). Границы чётные,
+    // тогда полосы можно рисовать из разных потоков
+    void draw_sprite_to_frame(
+        const Yuv_Sprite &sprite,
+        const float x,
+        const float y,
+        const int row_begin,
+        const int row_end,
+        Frame_Yuv420 &frame);
+}
+
+#endif
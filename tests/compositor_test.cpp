@@ -0,0 +1,241 @@
+// Проверка ядер смешивания из compositor.h: скалярное, SSE4.1
+// и AVX2 совпадают побайтно, а с прежним поточечным смешиванием
+// во float расходятся не больше чем на 1
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "compositor.h"
+
+namespace
+{
+    // Незатрагиваемые байты вокруг строки кадра
+    constexpr int guard = 16;
+    constexpr uint8_t guard_value = 0xA5;
+    
+    struct Kernel
+    {
+        std::string name;
+        InSomnia::Blend_Row_Function blend_row;
+    };
+    
+    int count_failures = 0;
+    
+    void fail(const std::string &message)
+    {
+        std::fprintf(stderr, "Ошибка: %s\n", message.c_str());
+        ++count_failures;
+    }
+    
+    // Прежний blend_pixel: альфа во float, результат усекается
+    uint8_t blend_float(
+        const uint8_t s,
+        const uint8_t d,
+        const uint8_t a)
+    {
+        const float alpha = a / 255.0f;
+        return static_cast<uint8_t>(alpha * s + (1 - alpha) * d);
+    }
+    
+    // То же для цвета, уже умноженного на альфу
+    uint8_t blend_float_premultiplied(
+        const uint8_t s,
+        const uint8_t d,
+        const uint8_t a)
+    {
+        const float alpha = a / 255.0f;
+        return static_cast<uint8_t>(s + (1 - alpha) * d + 0.5f);
+    }
+    
+    std::vector<Kernel> get_kernels(const bool is_premultiplied)
+    {
+        std::vector<Kernel> kernels;
+        
+        kernels.push_back({
+            "scalar",
+            is_premultiplied ?
+                InSomnia::blend_row_premultiplied_scalar :
+                InSomnia::blend_row_scalar });
+
+#ifdef INSOMNIA_X86_SIMD
+        __builtin_cpu_init();
+        
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            kernels.push_back({
+                "sse4.1",
+                is_premultiplied ?
+                    InSomnia::blend_row_premultiplied_sse41 :
+                    InSomnia::blend_row_sse41 });
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            kernels.push_back({
+                "avx2",
+                is_premultiplied ?
+                    InSomnia::blend_row_premultiplied_avx2 :
+                    InSomnia::blend_row_avx2 });
+        }
+#endif
+        
+        return kernels;
+    }
+    
+    // Строка BGRA с альфами 0, 255 и промежуточными вперемешку
+    std::vector<uint8_t> make_src(
+        const int count,
+        const bool is_premultiplied,
+        std::mt19937 &gen)
+    {
+        std::uniform_int_distribution<int> dist_byte(0, 255);
+        std::uniform_int_distribution<int> dist_kind(0, 3);
+        
+        std::vector<uint8_t> src(4 * count);
+        
+        for (int i = 0; i < count; ++i)
+        {
+            const int kind = dist_kind(gen);
+            const int a = kind == 0 ? 0 : (kind == 1 ? 255 : dist_byte(gen));
+            
+            for (int c = 0; c < 3; ++c)
+            {
+                const int value = dist_byte(gen);
+                src[4 * i + c] = static_cast<uint8_t>(
+                    is_premultiplied ? (value * a + 127) / 255 : value);
+            }
+            src[4 * i + 3] = static_cast<uint8_t>(a);
+        }
+        
+        return src;
+    }
+    
+    // Кадр из width пикселей с охраной по краям; ядро смешивает
+    // отрезок [x_begin, x_begin + count) — как обрезанная
+    // краем кадра строка спрайта
+    void check_row(
+        const int width,
+        const int x_begin,
+        const int count,
+        const bool is_premultiplied,
+        const std::vector<Kernel> &kernels,
+        std::mt19937 &gen)
+    {
+        std::uniform_int_distribution<int> dist_byte(0, 255);
+        
+        const std::vector<uint8_t> src =
+            make_src(count, is_premultiplied, gen);
+        
+        std::vector<uint8_t> frame(3 * width + 2 * guard, guard_value);
+        for (int i = guard; i < guard + 3 * width; ++i)
+        {
+            frame[i] = static_cast<uint8_t>(dist_byte(gen));
+        }
+        
+        std::vector<uint8_t> result_first;
+        
+        for (const Kernel &kernel : kernels)
+        {
+            std::vector<uint8_t> dst = frame;
+            kernel.blend_row(src.data(), dst.data() + guard + 3 * x_begin, count);
+            
+            const std::string where =
+                kernel.name + (is_premultiplied ? " premultiplied" : "") +
+                ", ширина " + std::to_string(width) +
+                ", отрезок [" + std::to_string(x_begin) + ", " +
+                std::to_string(x_begin + count) + ")";
+            
+            for (int i = 0; i < static_cast<int>(dst.size()); ++i)
+            {
+                const int idx_pixel = (i - guard) / 3;
+                const bool is_inside =
+                    i >= guard && i < guard + 3 * width &&
+                    idx_pixel >= x_begin && idx_pixel < x_begin + count;
+                
+                if (!is_inside)
+                {
+                    if (dst[i] != frame[i])
+                    {
+                        fail(where + ": запись за пределы отрезка");
+                        return;
+                    }
+                    continue;
+                }
+                
+                const int c = (i - guard) % 3;
+                const int idx_src = 4 * (idx_pixel - x_begin);
+                const uint8_t s = src[idx_src + c];
+                const uint8_t a = src[idx_src + 3];
+                
+                const int expected = is_premultiplied ?
+                    blend_float_premultiplied(s, frame[i], a) :
+                    blend_float(s, frame[i], a);
+                
+                if (std::abs(dst[i] - expected) > 1)
+                {
+                    fail(where + ": расхождение с float больше 1");
+                    return;
+                }
+            }
+            
+            if (result_first.empty())
+            {
+                result_first = dst;
+            }
+            else if (dst != result_first)
+            {
+                fail(where + ": не совпадает побайтно с " + kernels[0].name);
+                return;
+            }
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 gen(20251231u);
+    
+    for (const bool is_premultiplied : { false, true })
+    {
+        const std::vector<Kernel> kernels = get_kernels(is_premultiplied);
+        
+        // Все короткие длины, включая нечётные и хвосты
+        // меньше ширины регистра
+        for (int count = 1; count <= 67; ++count)
+        {
+            check_row(count, 0, count, is_premultiplied, kernels, gen);
+        }
+        
+        // Обрезанные строки: отрезок внутри более широкого кадра,
+        // прижатый к левому, правому краю или посередине
+        std::uniform_int_distribution<int> dist_width(1, 300);
+        for (int i = 0; i < 2000; ++i)
+        {
+            const int width = dist_width(gen);
+            std::uniform_int_distribution<int> dist_x(0, width - 1);
+            const int x_begin = dist_x(gen);
+            std::uniform_int_distribution<int> dist_count(1, width - x_begin);
+            
+            check_row(
+                width, x_begin, dist_count(gen),
+                is_premultiplied, kernels, gen);
+        }
+        
+        std::printf(
+            "Ядер%s: %zu\n",
+            is_premultiplied ? " (умноженная альфа)" : "",
+            kernels.size());
+    }
+    
+    if (count_failures > 0)
+    {
+        std::fprintf(stderr, "Ошибок: %d\n", count_failures);
+        return 1;
+    }
+    
+    std::printf("Ядра совпадают\n");
+    return 0;
+}